@@ -0,0 +1,182 @@
+"""
+helper script to measure how CryptContext.verify() & TOTP.match() scale across threads.
+
+each target runs a fixed number of calls split evenly across 1, 2, 4 ... N threads
+(all sharing the same CryptContext / TOTP object), and reports the throughput,
+speedup relative to a single thread, and efficiency (speedup / threads).
+
+near-linear speedup is only expected for backends which release the GIL
+(e.g. hashlib's pbkdf2_hmac, the ``bcrypt`` package), or under a free-threaded
+python build (3.13t+); otherwise efficiency will fall off as 1 / threads.
+
+usage: python admin/bench_threads.py [-t max_threads] [-n calls] [target ...]
+"""
+#=============================================================================
+# init script env
+#=============================================================================
+from __future__ import absolute_import, division, print_function, unicode_literals
+
+# make sure passlib source dir is first in import path
+import os, sys
+os.chdir(os.path.abspath(os.path.join(__file__, *[".."]*2)))
+sys.path.insert(0, "")
+
+#=============================================================================
+# imports
+#=============================================================================
+# core
+from argparse import ArgumentParser
+import threading
+# site
+# pkg
+from passlib.context import CryptContext
+from passlib.registry import get_crypt_handler
+from passlib.totp import TOTP
+from passlib.utils import cpu_count, tick
+# local
+
+#=============================================================================
+# helpers
+#=============================================================================
+
+#: targets measured by default, with settings used to generate sample hash
+DEFAULT_TARGETS = [
+    ("pbkdf2_sha256", dict(rounds=20000)),
+    ("sha256_crypt", dict(rounds=5000)),
+    ("bcrypt", dict(rounds=8)),
+    ("argon2", dict(rounds=2, memory_cost=1024)),
+    ("ldap_salted_sha1", {}),
+    ("totp", {}),
+]
+
+_SECRET = "stub"
+
+def make_verify(name, settings):
+    """return callable which runs one verify() call, or None if scheme has no backend"""
+    handler = get_crypt_handler(name)
+    if hasattr(handler, "has_backend") and not handler.has_backend():
+        return None
+    options = dict(("%s__%s" % (name, key), value) for key, value in settings.items())
+    context = CryptContext([name], **options)
+    hash = context.hash(_SECRET)
+    verify = context.verify
+
+    def run():
+        if not verify(_SECRET, hash):
+            raise RuntimeError("verify() failed")
+    return run
+
+def make_totp_match():
+    """return callable which runs one TOTP.match() call"""
+    totp = TOTP(new=True)
+    time = 1500000000
+    token = totp.generate(time).token
+
+    def run():
+        totp.match(token, time)
+    return run
+
+def run_threads(func, threads, count):
+    """run *count* calls of *func* split across *threads* threads, returning elapsed time"""
+    per_thread = count // threads
+    errors = []
+    barrier = threading.Barrier(threads + 1)
+
+    def target():
+        barrier.wait()
+        try:
+            for _ in range(per_thread):
+                func()
+        except Exception as err: # pragma: no cover -- reported below
+            errors.append(err)
+
+    workers = [threading.Thread(target=target) for _ in range(threads)]
+    for worker in workers:
+        worker.start()
+    barrier.wait()
+    start = tick()
+    for worker in workers:
+        worker.join()
+    elapsed = tick() - start
+    if errors:
+        raise errors[0]
+    return elapsed, per_thread * threads
+
+def calibrate(func, target=0.5):
+    """pick number of calls which takes roughly *target* seconds on a single thread"""
+    count = 1
+    while True:
+        start = tick()
+        for _ in range(count):
+            func()
+        elapsed = tick() - start
+        if elapsed > target / 8:
+            return max(1, int(count * target / elapsed))
+        count *= 2
+
+def thread_levels(limit):
+    """return powers of 2 up to (and including) *limit*"""
+    levels = []
+    value = 1
+    while value < limit:
+        levels.append(value)
+        value *= 2
+    levels.append(limit)
+    return levels
+
+def gil_status():
+    """return description of whether GIL is active"""
+    is_gil_enabled = getattr(sys, "_is_gil_enabled", None)
+    if is_gil_enabled is None:
+        return "enabled"
+    return "enabled" if is_gil_enabled() else "disabled (free-threaded)"
+
+#=============================================================================
+# main
+#=============================================================================
+def main(*args):
+    parser = ArgumentParser(description="measure multi-threaded scaling of verify() & TOTP.match()")
+    parser.add_argument("targets", nargs="*", help="schemes to measure, or 'totp' "
+                        "(default: %s)" % " ".join(name for name, _ in DEFAULT_TARGETS))
+    parser.add_argument("-t", "--max-threads", type=int, default=cpu_count(),
+                        help="largest number of threads to try (default: %(default)s)")
+    parser.add_argument("-n", "--number", type=int, default=None,
+                        help="total calls per measurement (default: ~0.5s worth on one thread)")
+    opts = parser.parse_args(args)
+
+    if opts.targets:
+        targets = [(name, {}) for name in opts.targets]
+    else:
+        targets = DEFAULT_TARGETS
+    levels = thread_levels(opts.max_threads)
+
+    print("python %s, %d cpus, GIL %s" % (sys.version.split()[0], cpu_count(), gil_status()))
+    print("%-20s %7s %11s %9s %10s" % ("target", "threads", "calls/s", "speedup", "efficiency"))
+    for name, settings in targets:
+        if name == "totp":
+            func = make_totp_match()
+        else:
+            func = make_verify(name, settings)
+            if func is None:
+                print("%-20s %7s" % (name, "(no backend)"))
+                continue
+        func()  # warm up any caches / lazy backend loading
+        count = opts.number or calibrate(func)
+        # NOTE: rounding count up so it splits evenly across largest thread count
+        count = -(-count // levels[-1]) * levels[-1]
+        base = None
+        for threads in levels:
+            elapsed, calls = run_threads(func, threads, count)
+            rate = calls / elapsed
+            if base is None:
+                base = rate
+            speedup = rate / base
+            print("%-20s %7d %11.1f %8.2fx %9.0f%%" % (name, threads, rate, speedup,
+                                                      100 * speedup / threads))
+
+if __name__ == "__main__":
+    sys.exit(main(*sys.argv[1:]))
+
+#=============================================================================
+# eof
+#=============================================================================
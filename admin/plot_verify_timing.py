@@ -1,113 +1,308 @@
 #!/usr/bin/env python3
 """
-small helper script used to compare timing of verify() & dummy_verify()
+helper script used to compare timing of verify() & dummy_verify().
+
+for every scheme & user category configured in a CryptContext, this times
+verify() of the correct password, verify() of a wrong password, and dummy_verify(),
+interleaving the samples so drift affects all three equally.  outliers are trimmed
+(using 1.5 IQR fences), and the distributions compared via their medians
+and a two-sample Kolmogorov-Smirnov test.
+
+results are written as JSON; the exit code is 1 if dummy_verify()'s median time
+differs from that of the default scheme in any category by more than ``--tolerance``
+(or if the KS p-value is below ``--alpha``, when given), so this can be run
+as a check after each change to an application's policy::
+
+    python admin/plot_verify_timing.py --config app.ini --section passlib -o timing.json
+
+passing ``--pdf`` additionally plots the samples for the default scheme (requires matplotlib).
 """
 # core
 from __future__ import absolute_import, division, print_function, unicode_literals
 from argparse import ArgumentParser
+import json
+import math
 import sys
 from timeit import default_timer as tick
 # site
-import matplotlib.pyplot as plt
-from matplotlib.backends.backend_pdf import PdfPages
 # pkg
 from passlib.context import CryptContext
 # local
 __all__ = [
+    "trim_outliers",
+    "summarize",
+    "ks_test",
+    "measure_context",
     "main"
 ]
 
-def main(*args):
-    #
-    # parse args
-    #
-    parser = ArgumentParser("""plot hash timing""")
-    parser.add_argument("-n", "--number", help="number of iterations",
-                        type=int, default=300)
-    parser.add_argument("-o", "--output", help="pdf file",
-                        default="plot_hash.pdf")
+#=============================================================================
+# statistics helpers
+#=============================================================================
+def _quantile(sorted_values, q):
+    """return *q* quantile of sorted list, using linear interpolation"""
+    pos = (len(sorted_values) - 1) * q
+    lower = int(math.floor(pos))
+    upper = min(lower + 1, len(sorted_values) - 1)
+    return sorted_values[lower] + (sorted_values[upper] - sorted_values[lower]) * (pos - lower)
 
-    opts = parser.parse_args(args)
+def trim_outliers(samples):
+    """return ``(kept, removed_count)``, dropping samples outside the 1.5 IQR fences"""
+    values = sorted(samples)
+    q1 = _quantile(values, .25)
+    q3 = _quantile(values, .75)
+    iqr = q3 - q1
+    lb = q1 - 1.5 * iqr
+    ub = q3 + 1.5 * iqr
+    kept = [value for value in values if lb <= value <= ub]
+    return kept, len(values) - len(kept)
 
-    #
-    # init vars
-    #
-    ctx = CryptContext(schemes=["pbkdf2_sha256"])
+def summarize(samples):
+    """return dict of summary statistics (in seconds) for trimmed samples"""
+    kept, removed = trim_outliers(samples)
+    count = len(kept)
+    mean = sum(kept) / count
+    stdev = math.sqrt(sum((value - mean) ** 2 for value in kept) / (count - 1)) if count > 1 else 0.0
+    return dict(
+        count=count,
+        outliers=removed,
+        mean=mean,
+        stdev=stdev,
+        median=_quantile(kept, .5),
+        p05=_quantile(kept, .05),
+        p95=_quantile(kept, .95),
+    )
+
+def ks_test(a, b):
+    """
+    two-sample Kolmogorov-Smirnov test.
+
+    :returns:
+        ``(statistic, pvalue)``, using the asymptotic distribution for the p-value
+        (accurate enough for the few hundred samples this script uses).
+    """
+    a = sorted(a)
+    b = sorted(b)
+    n, m = len(a), len(b)
+    i = j = 0
+    d = 0.0
+    while i < n and j < m:
+        value = min(a[i], b[j])
+        while i < n and a[i] == value:
+            i += 1
+        while j < m and b[j] == value:
+            j += 1
+        d = max(d, abs(i / n - j / m))
+    en = math.sqrt(n * m / (n + m))
+    lam = (en + 0.12 + 0.11 / en) * d
+    if lam < 0.2:
+        # series converges too slowly here, but result is ~1 anyways
+        return d, 1.0
+    pvalue = 2 * sum((-1) ** (k - 1) * math.exp(-2 * k * k * lam * lam) for k in range(1, 101))
+    return d, min(1.0, max(0.0, pvalue))
 
-    secret = "a9w3857naw958ioa"
-    wrong_secret = "q0389wairuowieru"
-    hash = ctx.hash(secret)
-    ctx.dummy_verify()
+#=============================================================================
+# measurement
+#=============================================================================
+SECRET = "a9w3857naw958ioa"
+WRONG_SECRET = "q0389wairuowieru"
 
+def _time(func, *args, **kwds):
+    start = tick()
+    func(*args, **kwds)
+    return tick() - start
+
+def measure_pair(ctx, scheme, category, number, warmup=10):
+    """
+    time verify() of correct & wrong password against a hash generated by *scheme*
+    (using *category*'s settings), interleaved with dummy_verify() calls.
+
+    :returns: ``(correct, wrong, dummy)`` lists of seconds.
+    """
+    handler = ctx.handler(scheme, category)
+    kwds = {}
+    if "user" in handler.context_kwds:
+        kwds["user"] = "user"
+    hash = handler.hash(SECRET, **kwds)
+    verify = ctx.verify
+    dummy_verify = ctx.dummy_verify
+    dummy_verify()
     correct = []
     wrong = []
-    missing = []
+    dummy = []
+    for idx in range(warmup + number):
+        samples = (_time(verify, SECRET, hash, category=category, **kwds),
+                   _time(verify, WRONG_SECRET, hash, category=category, **kwds),
+                   _time(dummy_verify))
+        if idx >= warmup:
+            correct.append(samples[0])
+            wrong.append(samples[1])
+            dummy.append(samples[2])
+    return correct, wrong, dummy
 
-    loops = opts.number
+def measure_context(ctx, number=300, tolerance=0.1, alpha=None, schemes=None, raw=False):
+    """
+    run timing comparison for each (category, scheme) pair in context.
 
-    #
-    # run timing loop
-    #
-    for _ in range(loops):
-        # correct pwd
-        start = tick()
-        ctx.verify(secret, hash)
-        delta = tick() - start
-        correct.append(delta)
-
-        # wrong pwd
-        start = tick()
-        ctx.verify(wrong_secret, hash)
-        delta = tick() - start
-        wrong.append(delta)
-
-        # wrong user / dummy verify
-        start = tick()
-        ctx.dummy_verify()
-        delta = tick() - start
-        missing.append(delta)
+    :returns:
+        dict suitable for serializing as JSON, containing a ``"results"`` list,
+        and an ``"ok"`` flag indicating whether all checked entries were within tolerance.
+    """
+    categories = (None,) + ctx._config.categories
+    results = []
+    ok = True
+    for category in categories:
+        default = ctx.default_scheme(category)
+        for scheme in (schemes or ctx.schemes()):
+            handler = ctx.handler(scheme, category)
+            if handler.is_disabled:
+                continue
+            correct, wrong, dummy = measure_pair(ctx, scheme, category, number)
+            real = correct + wrong
+            real_stats = summarize(real)
+            dummy_stats = summarize(dummy)
+            ratio = dummy_stats["median"] / real_stats["median"]
+            statistic, pvalue = ks_test(trim_outliers(real)[0], trim_outliers(dummy)[0])
+            checked = (scheme == default)
+            passed = abs(ratio - 1) <= tolerance and (alpha is None or pvalue >= alpha)
+            if checked and not passed:
+                ok = False
+            entry = dict(
+                category=category,
+                scheme=scheme,
+                backend=handler.get_backend() if hasattr(handler, "get_backend") else None,
+                is_default=checked,
+                verify_correct=summarize(correct),
+                verify_wrong=summarize(wrong),
+                verify=real_stats,
+                dummy_verify=dummy_stats,
+                median_ratio=ratio,
+                ks_statistic=statistic,
+                ks_pvalue=pvalue,
+                correct_vs_wrong_ks_pvalue=ks_test(trim_outliers(correct)[0],
+                                                   trim_outliers(wrong)[0])[1],
+                passed=passed,
+            )
+            if raw:
+                entry["samples"] = dict(correct=correct, wrong=wrong, dummy=dummy)
+            results.append(entry)
+    return dict(
+        config=ctx.to_string(),
+        number=number,
+        tolerance=tolerance,
+        alpha=alpha,
+        ok=ok,
+        results=results,
+    )
+
+#=============================================================================
+# plotting
+#=============================================================================
+def plot(report, path):
+    """plot raw samples for default scheme (of default category) into pdf file"""
+    import matplotlib
+    matplotlib.use("Agg")
+    import matplotlib.pyplot as plt
+    from matplotlib.backends.backend_pdf import PdfPages
+
+    entry = next(entry for entry in report["results"]
+                 if entry["category"] is None and entry["is_default"])
+    samples = entry["samples"]
+    loops = len(samples["correct"])
 
-    #
     # calc quartiles for verify() samples
-    #
-    samples = sorted(correct + wrong)
-    count = len(samples)
-    q1 = samples[count // 4]
-    q3 = samples[count * 3 // 4]
+    stats = entry["verify"]
+    values = sorted(samples["correct"] + samples["wrong"])
+    q1 = _quantile(values, .25)
+    q3 = _quantile(values, .75)
     iqr = q3 - q1
     ub = q3 + 1.5 * iqr
     lb = q1 - 1.5 * iqr
+    values.extend(samples["dummy"])
+    ymin = min(min(values), lb - 0.5 * iqr)
+    ymax = max(max(values), ub)
 
-    #
-    # add in dummy samples, calc bounds
-    #
-    samples.extend(missing)
-    ymin = min(min(samples), lb - 0.5 * iqr)
-    ymax = max(max(samples), ub)
-
-    #
-    # generate graph
-    #
-    with PdfPages(opts.output) as pdf:
-        plt.plot(range(loops), correct, 'go', label="verify success")
-        plt.plot(range(loops), wrong, 'yo', label="verify failed")
-        plt.plot(range(loops), missing, 'ro', label="dummy_verify()")
+    with PdfPages(path) as pdf:
+        plt.plot(range(loops), samples["correct"], 'go', label="verify success")
+        plt.plot(range(loops), samples["wrong"], 'yo', label="verify failed")
+        plt.plot(range(loops), samples["dummy"], 'ro', label="dummy_verify()")
 
         plt.axis([0, loops, ymin, ymax])
 
-        plt.axhline(y=q1, xmax=count, color="r")
-        plt.axhline(y=q3, xmax=count, color="r")
-        plt.axhline(y=lb, xmax=count, color="orange")
-        plt.axhline(y=ub, xmax=count, color="orange")
+        plt.axhline(y=q1, color="r")
+        plt.axhline(y=q3, color="r")
+        plt.axhline(y=lb, color="orange")
+        plt.axhline(y=ub, color="orange")
+        plt.axhline(y=stats["median"], color="g")
 
         plt.ylabel('elapsed time')
         plt.xlabel('loop count')
         plt.legend(shadow=True, title="Legend", fancybox=True)
 
-        plt.title('%s verify timing' % ctx.handler().name)
+        plt.title('%s verify timing' % entry["scheme"])
         pdf.savefig()
         plt.close()
 
+#=============================================================================
+# main
+#=============================================================================
+def main(*args):
+    #
+    # parse args
+    #
+    parser = ArgumentParser(description="compare timing of verify() & dummy_verify()")
+    parser.add_argument("-n", "--number", help="number of samples per measurement",
+                        type=int, default=300)
+    parser.add_argument("-c", "--config", help="CryptContext ini file to load "
+                        "(default: pbkdf2_sha256 only)")
+    parser.add_argument("--section", help="ini file section (default: %(default)s)",
+                        default="passlib")
+    parser.add_argument("-s", "--scheme", dest="schemes", action="append",
+                        help="only measure specified scheme (may be repeated)")
+    parser.add_argument("-t", "--tolerance", type=float, default=0.1,
+                        help="max relative difference allowed between median "
+                             "dummy_verify() & verify() times (default: %(default)s)")
+    parser.add_argument("--alpha", type=float, default=None,
+                        help="if set, also fail when KS test p-value is below this")
+    parser.add_argument("-o", "--output", help="json file (default: stdout)")
+    parser.add_argument("--raw", action="store_true", help="include raw samples in json")
+    parser.add_argument("--pdf", help="also plot samples for default scheme to pdf file")
+
+    opts = parser.parse_args(args)
+
+    #
+    # init vars
+    #
+    if opts.config:
+        ctx = CryptContext.from_path(opts.config, section=opts.section)
+    else:
+        ctx = CryptContext(schemes=["pbkdf2_sha256"])
+
+    #
+    # run timing loops & write results
+    #
+    report = measure_context(ctx, number=opts.number, tolerance=opts.tolerance,
+                             alpha=opts.alpha, schemes=opts.schemes,
+                             raw=opts.raw or bool(opts.pdf))
+    if opts.pdf:
+        plot(report, opts.pdf)
+        if not opts.raw:
+            for entry in report["results"]:
+                del entry["samples"]
+    data = json.dumps(report, indent=2, sort_keys=True)
+    if opts.output:
+        with open(opts.output, "w") as fh:
+            fh.write(data + "\n")
+    else:
+        print(data)
+
+    for entry in report["results"]:
+        if entry["is_default"] and not entry["passed"]:
+            print("FAILED: category=%s scheme=%s: dummy_verify() / verify() median ratio=%.3f, "
+                  "ks p-value=%.3g" % (entry["category"], entry["scheme"],
+                                       entry["median_ratio"], entry["ks_pvalue"]),
+                  file=sys.stderr)
+    return 0 if report["ok"] else 1
+
 if __name__ == "__main__":
     sys.exit(main(*sys.argv[1:]))
-
@@ -13,9 +13,69 @@ from passlib.registry import get_crypt_handler
 from passlib.utils import tick
 # local
 __all__ = [
+    "rounds_to_cost",
+    "cost_to_rounds",
+    "clamp_rounds",
+    "estimate_speed",
     "main",
 ]
 
+#=============================================================================
+# helpers
+#=============================================================================
+
+# NOTE: "cost" is proportional to the time a hash takes,
+#       i.e. rounds for linear hashes, and 2**rounds for log2 hashes.
+
+def rounds_to_cost(hasher, rounds):
+    """convert hasher's rounds value to linear cost"""
+    if hasher.rounds_cost == "log2":
+        # time cost varies logarithmically with rounds parameter,
+        # so speed = (2**rounds) / elapsed
+        return 2 ** rounds
+    else:
+        # time cost varies linearly with rounds parameter,
+        # so speed = rounds / elapsed
+        assert hasher.rounds_cost == "linear"
+        return rounds
+
+def cost_to_rounds(hasher, cost):
+    """convert linear cost to hasher's (float) rounds value"""
+    if hasher.rounds_cost == "log2":
+        return math.log(cost, 2)
+    else:
+        assert hasher.rounds_cost == "linear"
+        return cost
+
+def clamp_rounds(hasher, rounds):
+    """convert float rounds to int value, clamped to hasher's limits"""
+    if hasher.max_rounds and rounds > hasher.max_rounds:
+        rounds = hasher.max_rounds
+    rounds = int(rounds)
+    if getattr(hasher, "_avoid_even_rounds", False):
+        rounds |= 1
+    return max(hasher.min_rounds, rounds)
+
+def _average(seq):
+    if not hasattr(seq, "__length__"):
+        seq = tuple(seq)
+    return sum(seq) / len(seq)
+
+def estimate_speed(hasher, rounds):
+    """estimate speed (cost / second) of single-threaded verify() using specified # of rounds"""
+    # time a single verify() call
+    secret = "S0m3-S3Kr1T"
+    hash = hasher.using(rounds=rounds).hash(secret)
+    def helper():
+        start = tick()
+        hasher.verify(secret, hash)
+        return tick() - start
+    # try to get average time over a few samples
+    # XXX: way too much variability between sampling runs,
+    #      would like to improve this bit
+    elapsed = min(_average(helper() for _ in range(4)) for _ in range(4))
+    return rounds_to_cost(hasher, rounds) / elapsed
+
 #=============================================================================
 # main
 #=============================================================================
@@ -69,65 +129,20 @@ def main(*args):
             print_error("%s does not support multiple backends")
             return 1
 
-    #---------------------------------------------------------------
-    # setup some helper functions
-    #---------------------------------------------------------------
-    if hasher.rounds_cost == "log2":
-        # time cost varies logarithmically with rounds parameter,
-        # so speed = (2**rounds) / elapsed
-        def rounds_to_cost(rounds):
-            return 2 ** rounds
-        def cost_to_rounds(cost):
-            return math.log(cost, 2)
-    else:
-        # time cost varies linearly with rounds parameter,
-        # so speed = rounds / elapsed
-        assert hasher.rounds_cost == "linear"
-        rounds_to_cost = cost_to_rounds = lambda value: value
-
-    def clamp_rounds(rounds):
-        """convert float rounds to int value, clamped to hasher's limits"""
-        if hasher.max_rounds and rounds > hasher.max_rounds:
-            rounds = hasher.max_rounds
-        rounds = int(rounds)
-        if getattr(hasher, "_avoid_even_rounds", False):
-            rounds |= 1
-        return max(hasher.min_rounds, rounds)
-
-    def average(seq):
-        if not hasattr(seq, "__length__"):
-            seq = tuple(seq)
-        return sum(seq) / len(seq)
-
-    def estimate_speed(rounds):
-        """estimate speed using specified # of rounds"""
-        # time a single verify() call
-        secret = "S0m3-S3Kr1T"
-        hash = hasher.using(rounds=rounds).hash(secret)
-        def helper():
-            start = tick()
-            hasher.verify(secret, hash)
-            return tick() - start
-        # try to get average time over a few samples
-        # XXX: way too much variability between sampling runs,
-        #      would like to improve this bit
-        elapsed = min(average(helper() for _ in range(4)) for _ in range(4))
-        return rounds_to_cost(rounds) / elapsed
-
     #---------------------------------------------------------------
     # get rough estimate of speed using fraction of default_rounds
     # (so we don't take crazy long amounts of time on slow systems)
     #---------------------------------------------------------------
-    rounds = clamp_rounds(cost_to_rounds(.5 * rounds_to_cost(hasher.default_rounds)))
-    speed = estimate_speed(rounds)
+    rounds = clamp_rounds(hasher, cost_to_rounds(hasher, .5 * rounds_to_cost(hasher, hasher.default_rounds)))
+    speed = estimate_speed(hasher, rounds)
 
     #---------------------------------------------------------------
     # re-do estimate using previous result,
     # to get more accurate sample using a larger number of rounds.
     #---------------------------------------------------------------
     for _ in range(2):
-        rounds = clamp_rounds(cost_to_rounds(speed * target))
-        speed = estimate_speed(rounds)
+        rounds = clamp_rounds(hasher, cost_to_rounds(hasher, speed * target))
+        speed = estimate_speed(hasher, rounds)
 
     #---------------------------------------------------------------
     # using final estimate, calc desired number of rounds for target time
@@ -141,31 +156,31 @@ def main(*args):
         speedstr = int(speed)
     print("speed...........: %s iterations/second" % speedstr)
     print("target time.....: %d ms" % (target*1000,))
-    rounds = cost_to_rounds(speed * target)
+    rounds = cost_to_rounds(hasher, speed * target)
     if hasher.rounds_cost == "log2":
         # for log2 rounds parameter, target time will usually fall
         # somewhere between two integer values, which will have large gulf
         # between them. if target is within <tolerance> percent of
         # one of two ends, report it, otherwise list both and let user decide.
         tolerance = .05
-        lower = clamp_rounds(rounds)
-        upper = clamp_rounds(math.ceil(rounds))
-        lower_elapsed = rounds_to_cost(lower) / speed
-        upper_elapsed = rounds_to_cost(upper) / speed
+        lower = clamp_rounds(hasher, rounds)
+        upper = clamp_rounds(hasher, math.ceil(rounds))
+        lower_elapsed = rounds_to_cost(hasher, lower) / speed
+        upper_elapsed = rounds_to_cost(hasher, upper) / speed
         if (target-lower_elapsed)/target < tolerance:
             print("target rounds...: %d" % lower)
         elif (upper_elapsed-target)/target < tolerance:
             print("target rounds...: %d" % upper)
         else:
             faster = (target - lower_elapsed)
-            prin("target rounds...: %d (%dms -- %dms/%d%% faster than requested)" % \
+            print("target rounds...: %d (%dms -- %dms/%d%% faster than requested)" % \
                   (lower, lower_elapsed*1000, faster * 1000, round(100 * faster / target)))
             slower = (upper_elapsed - target)
             print("target rounds...: %d (%dms -- %dms/%d%% slower than requested)" % \
                   (upper, upper_elapsed*1000, slower * 1000, round(100 * slower / target)))
     else:
         # for linear rounds parameter, just use nearest integer value
-        rounds = clamp_rounds(round(rounds))
+        rounds = clamp_rounds(hasher, round(rounds))
         print("target rounds...: %d" % (rounds,))
     print()
 
@@ -0,0 +1,640 @@
+"""passlib.bulk - parallel bulk hashing of password records
+
+This module can be used as a library (see :func:`hash_records`),
+or as a command line tool: ``python -m passlib.bulk --help``.
+"""
+#=============================================================================
+# imports
+#=============================================================================
+# core
+from __future__ import absolute_import, division, print_function
+import csv
+import io
+from itertools import count, islice
+import json
+import logging; log = logging.getLogger(__name__)
+import os
+import sys
+import threading
+# site
+# pkg
+from passlib.context import CryptContext
+from passlib.exc import _rebuild_error
+from passlib.utils import cpu_count, imap_ordered, timer
+from passlib.utils.compat import PY2
+# local
+__all__ = [
+    "hash_records",
+    "verify_records",
+    "InterpreterExecutor",
+    "ProgressReporter",
+    "main",
+]
+
+#=============================================================================
+# worker helpers
+#=============================================================================
+
+#: context used by worker processes (set by _init_worker)
+_worker_context = None
+
+def _init_worker(config):
+    """initializer for worker processes -- recreates context from config string"""
+    global _worker_context
+    _worker_context = CryptContext.from_string(config)
+
+def _get_worker_config(context):
+    """
+    return config string used by _init_worker() to recreate context.
+    this is checked up front, since a pool whose workers can't load it
+    would just keep respawning them, and never return.
+    """
+    config = context.to_string()
+    try:
+        CryptContext.from_string(config)
+    except (KeyError, ValueError, TypeError) as err:
+        raise ValueError("context can't be recreated from its to_string() output, "
+                         "so can't be used by worker processes (%s); "
+                         "use processes=False to share it with a thread pool instead" % (err,))
+    return config
+
+def _hash_chunk(chunk, context=None):
+    """hash list of ``(key, secret)`` pairs, returning list of ``(key, hash)``"""
+    hash = (context or _worker_context).hash
+    return [(key, hash(secret)) for key, secret in chunk]
+
+def _verify_chunk(chunk, context=None):
+    """verify list of ``(key, secret, hash)`` triples, returning list of ``(key, valid)``"""
+    verify = (context or _worker_context).verify
+    return [(key, verify(secret, hash)) for key, secret, hash in chunk]
+
+class _ContextChunkFunc(object):
+    """callable used to process chunks when using a thread pool"""
+    def __init__(self, context, func):
+        self.context = context
+        self.func = func
+
+    def __call__(self, chunk):
+        return self.func(chunk, self.context)
+
+class _ExecutorChunkFunc(object):
+    """callable used to process chunks when using an InterpreterExecutor"""
+    def __init__(self, executor, method):
+        self.executor = executor
+        self.method = method
+
+    def __call__(self, chunk):
+        # NOTE: only secrets & hashes are sent to the worker interpreters,
+        #       keys stay in this interpreter (so they needn't be shareable).
+        keys = [record[0] for record in chunk]
+        if self.method == "hash_many":
+            items = tuple(record[1] for record in chunk)
+        else:
+            items = tuple(record[1:] for record in chunk)
+        results = self.executor.submit(self.method, items).result()
+        return list(zip(keys, results))
+
+def _iter_chunks(source, size):
+    """split iterable into lists of <size> elements"""
+    itr = iter(source)
+    while True:
+        chunk = list(islice(itr, size))
+        if not chunk:
+            return
+        yield chunk
+
+#=============================================================================
+# library interface
+#=============================================================================
+def hash_records(context, records, workers=None, processes=True, chunk_size=64,
+                 progress=None):
+    """Hash a stream of records in parallel, using the context's default scheme.
+
+    :arg context:
+        :class:`~passlib.context.CryptContext` instance to use.
+
+    :arg records:
+        iterable of ``(key, secret)`` pairs. This is read incrementally,
+        so it may be arbitrarily large: only a few chunks per worker are held in memory.
+
+    :param workers:
+        number of workers (defaults to number of cpus).
+
+    :param processes:
+        By default, work is spread across a pool of processes
+        (which requires the context to be serializable via :meth:`~CryptContext.to_string`,
+        and *key* to be picklable; a :exc:`ValueError` is raised if the context can't be
+        recreated from its string, e.g. if it uses unregistered handlers).
+        If ``False``, a pool of threads is used instead,
+        which only helps for backends that release the GIL (e.g. ``bcrypt``).
+        If ``"interpreters"``, work is spread across an :class:`InterpreterExecutor`
+        (requires Python 3.14+).
+
+    :param chunk_size:
+        number of records sent to a worker at once (defaults to 64).
+
+    :param progress:
+        optional callable, invoked with the number of records hashed
+        as each chunk completes (e.g. a :class:`ProgressReporter`).
+
+    :returns:
+        iterator of ``(key, hash)`` pairs, in the same order as *records*.
+        Invalid arguments are reported when this function is called,
+        before any records are read.
+
+    .. versionadded:: 1.8
+    """
+    return _map_records(_hash_chunk, context, records, workers, processes,
+                        chunk_size, progress)
+
+def verify_records(context, records, workers=None, processes=True, chunk_size=64,
+                   progress=None):
+    """Verify a stream of records in parallel.
+
+    This is intended for bulk verification during migrations
+    (e.g. checking a dump of legacy :class:`~passlib.hash.phpass` hashes
+    against known passwords), where verifying one record at a time
+    would be limited to a single cpu.
+
+    :arg records:
+        iterable of ``(key, secret, hash)`` triples.
+
+    :returns:
+        iterator of ``(key, valid)`` pairs, in the same order as *records*.
+        Hashes which aren't recognized by the context will cause a :exc:`ValueError`.
+
+    All other arguments are the same as for :func:`hash_records`.
+
+    .. versionadded:: 1.8
+    """
+    return _map_records(_verify_chunk, context, records, workers, processes,
+                        chunk_size, progress)
+
+def _map_records(func, context, records, workers, processes, chunk_size, progress):
+    """
+    backend for hash_records() & verify_records() --
+    validates arguments up front, and returns generator which does the actual work.
+    """
+    if workers is None:
+        workers = cpu_count()
+    if workers < 1:
+        raise ValueError("workers must be >= 1")
+    if chunk_size < 1:
+        raise ValueError("chunk_size must be >= 1")
+    if processes == "interpreters":
+        if _interpreters is None:
+            raise RuntimeError("InterpreterExecutor requires sub-interpreter support "
+                               "(Python 3.14+)")
+        config = None
+    elif processes:
+        config = _get_worker_config(context)
+    else:
+        config = None
+    return _iter_map_records(func, context, config, _iter_chunks(records, chunk_size),
+                             workers, processes, progress)
+
+def _iter_map_records(func, context, config, chunks, workers, processes, progress):
+    """generator used by _map_records()"""
+    if processes == "interpreters":
+        pool = InterpreterExecutor(context, workers)
+        method = "hash_many" if func is _hash_chunk else "verify_many"
+        try:
+            # NOTE: imap_ordered()'s threads just wait on the executor's futures,
+            #       the actual work happens in the worker interpreters.
+            for results in imap_ordered(_ExecutorChunkFunc(pool, method), chunks,
+                                        workers=workers, max_pending=2 * workers):
+                for result in results:
+                    yield result
+                if progress:
+                    progress(len(results))
+        finally:
+            pool.shutdown()
+        return
+    if processes:
+        import multiprocessing
+        pool = multiprocessing.Pool(workers, initializer=_init_worker,
+                                    initargs=(config,))
+    else:
+        from multiprocessing.pool import ThreadPool
+        pool = ThreadPool(workers)
+        func = _ContextChunkFunc(context, func)
+    try:
+        for results in imap_ordered(func, chunks, workers=workers,
+                                    max_pending=2 * workers, pool=pool):
+            for result in results:
+                yield result
+            if progress:
+                progress(len(results))
+    finally:
+        pool.terminate()
+        pool.join()
+
+#=============================================================================
+# sub-interpreter executor
+#=============================================================================
+def _load_interpreters():
+    """return :mod:`!concurrent.interpreters` module, or ``None`` if not available"""
+    try:
+        from concurrent import interpreters
+    except ImportError:
+        return None
+    return interpreters
+
+#: :mod:`!concurrent.interpreters` module (python 3.14+), or ``None``
+_interpreters = _load_interpreters()
+
+#: CryptContext methods which InterpreterExecutor.submit() accepts
+#: (plus "hash_many" & "verify_many", used by hash_records() & verify_records())
+_executor_methods = frozenset(["hash", "verify", "verify_and_update", "needs_update",
+                               "identify", "hash_many", "verify_many"])
+
+#: code run by each worker interpreter (names are set via prepare_main())
+_executor_worker_source = """\
+import sys
+sys.path[:] = path
+from passlib.bulk import _executor_worker
+_executor_worker(config, requests, responses)
+"""
+
+def _executor_worker(config, requests, responses):
+    """
+    loop run inside each InterpreterExecutor worker --
+    reads ``(task_id, method, args, kwds)`` requests until it receives ``None``,
+    and writes ``(task_id, ok, result)`` responses, where *result* is
+    ``(error class name, message)`` if the call raised an error.
+    """
+    context = CryptContext.from_string(config)
+    while True:
+        request = requests.get()
+        if request is None:
+            return
+        task_id, method, args, kwds = request
+        kwds = dict(kwds)
+        try:
+            if method == "hash_many":
+                hash = context.hash
+                result = tuple(hash(secret, **kwds) for secret in args[0])
+            elif method == "verify_many":
+                verify = context.verify
+                result = tuple(verify(secret, hash, **kwds) for secret, hash in args[0])
+            else:
+                result = getattr(context, method)(*args, **kwds)
+        except Exception as err:
+            responses.put((task_id, False, (type(err).__name__, str(err))))
+        else:
+            responses.put((task_id, True, result))
+
+class InterpreterExecutor(object):
+    """Run :class:`~passlib.context.CryptContext` operations in a pool of sub-interpreters.
+
+    Each worker is a :pep:`684` sub-interpreter with its own GIL, running its own copy
+    of the context (recreated from :meth:`~CryptContext.to_string`).  This lets pure-python
+    backends (e.g. the builtin bcrypt, scrypt, or des_crypt backends) use multiple cpus from
+    a single process -- without the startup & pickling costs of a process pool.
+    Secrets, hashes and results are passed between interpreters as shareable objects,
+    rather than being pickled.
+
+    :arg context:
+        :class:`~passlib.context.CryptContext` instance to use.
+        It must be serializable via :meth:`~CryptContext.to_string`.
+
+    :param workers:
+        number of worker interpreters (defaults to number of cpus).
+
+    :raises RuntimeError:
+        if sub-interpreters aren't supported (requires Python 3.14+).
+
+    Extension modules used by the context's backends must support sub-interpreters,
+    which rules out some third-party backends (e.g. the ``bcrypt`` package).
+
+    Instances can be used as context managers, which call :meth:`shutdown` on exit.
+
+    .. automethod:: submit
+    .. automethod:: shutdown
+
+    .. versionadded:: 1.8
+    """
+    def __init__(self, context, workers=None):
+        if _interpreters is None:
+            raise RuntimeError("InterpreterExecutor requires sub-interpreter support "
+                               "(Python 3.14+)")
+        if workers is None:
+            workers = cpu_count()
+        if workers < 1:
+            raise ValueError("workers must be >= 1")
+        self._config = context.to_string()
+        self._requests = _interpreters.create_queue()
+        self._responses = _interpreters.create_queue()
+        self._futures = {}
+        self._task_ids = count()
+        self._lock = threading.Lock()
+        self._closed = False
+        self._broken = None
+        self._workers = [self._start_worker() for _ in range(workers)]
+        self._collector = threading.Thread(target=self._collect,
+                                           name="passlib-executor-collector")
+        self._collector.daemon = True
+        self._collector.start()
+
+    def _start_worker(self):
+        """create worker interpreter, and run its loop in a new thread"""
+        interp = _interpreters.create()
+        interp.prepare_main(config=self._config, requests=self._requests,
+                            responses=self._responses, path=tuple(sys.path))
+        thread = threading.Thread(target=self._run_worker, args=(interp,),
+                                  name="passlib-executor-worker")
+        thread.daemon = True
+        thread.start()
+        return interp, thread
+
+    def _run_worker(self, interp):
+        try:
+            interp.exec(_executor_worker_source)
+        except Exception as err:
+            # let collector fail pending futures, rather than leaving them waiting forever
+            log.error("InterpreterExecutor worker failed: %s", err)
+            self._responses.put((None, False, (type(err).__name__, str(err))))
+
+    def _collect(self):
+        """thread which reads responses, and resolves the corresponding futures"""
+        while True:
+            task_id, ok, result = self._responses.get()
+            if task_id is None:
+                if ok:
+                    # shutdown() marker
+                    return
+                with self._lock:
+                    self._broken = "worker interpreter failed: %s: %s" % result
+                    futures = list(self._futures.values())
+                    self._futures.clear()
+                for future in futures:
+                    future.set_exception(RuntimeError(self._broken))
+                continue
+            with self._lock:
+                future = self._futures.pop(task_id, None)
+            if future is None:
+                continue
+            if ok:
+                future.set_result(result)
+            else:
+                future.set_exception(_rebuild_error(*result))
+
+    def submit(self, method, *args, **kwds):
+        """
+        Schedule ``context.<method>(*args, **kwds)`` to run in a worker interpreter.
+
+        :arg method:
+            name of :class:`!CryptContext` method to call: one of ``"hash"``, ``"verify"``,
+            ``"verify_and_update"``, ``"needs_update"``, or ``"identify"``.
+
+        All arguments (and the result) must be shareable between interpreters
+        (e.g. :class:`!str`, :class:`!bytes`, :class:`!int`, ``None``, and tuples of these).
+
+        :returns:
+            :class:`concurrent.futures.Future` which resolves to the method's result.
+            Errors raised by the method are re-raised with the same class & message.
+        """
+        from concurrent.futures import Future
+        if method not in _executor_methods:
+            raise ValueError("unsupported method: %r" % (method,))
+        future = Future()
+        with self._lock:
+            if self._closed:
+                raise RuntimeError("cannot submit() after shutdown()")
+            if self._broken:
+                raise RuntimeError(self._broken)
+            task_id = next(self._task_ids)
+            self._futures[task_id] = future
+        self._requests.put((task_id, method, args, tuple(sorted(kwds.items()))))
+        return future
+
+    def hash(self, secret, **kwds):
+        """run :meth:`CryptContext.hash` in a worker interpreter, and wait for the result"""
+        return self.submit("hash", secret, **kwds).result()
+
+    def verify(self, secret, hash, **kwds):
+        """run :meth:`CryptContext.verify` in a worker interpreter, and wait for the result"""
+        return self.submit("verify", secret, hash, **kwds).result()
+
+    def verify_and_update(self, secret, hash, **kwds):
+        """run :meth:`CryptContext.verify_and_update` in a worker interpreter,
+        and wait for the result"""
+        return self.submit("verify_and_update", secret, hash, **kwds).result()
+
+    def shutdown(self):
+        """
+        Wait for pending calls to finish, then stop the worker interpreters.
+        Safe to call multiple times.
+        """
+        with self._lock:
+            if self._closed:
+                return
+            self._closed = True
+        for _ in self._workers:
+            self._requests.put(None)
+        for interp, thread in self._workers:
+            thread.join()
+            interp.close()
+        self._responses.put((None, True, None))
+        self._collector.join()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc_info):
+        self.shutdown()
+
+class ProgressReporter(object):
+    """Callable which periodically writes record count, throughput, and ETA to a stream.
+
+    :param total: total number of records expected (if known), used to calculate ETA.
+    :param stream: stream to write to (defaults to ``sys.stderr``).
+    :param interval: minimum number of seconds between reports (defaults to 1).
+    """
+    def __init__(self, total=None, stream=None, interval=1.0):
+        self.total = total
+        self.stream = stream or sys.stderr
+        self.interval = interval
+        self.count = 0
+        self.start = self._last = timer()
+
+    def __call__(self, count):
+        self.count += count
+        now = timer()
+        if now - self._last >= self.interval:
+            self._last = now
+            self.report(now)
+
+    @property
+    def rate(self):
+        """records per second"""
+        elapsed = timer() - self.start
+        return self.count / elapsed if elapsed > 0 else 0.0
+
+    def report(self, now=None, final=False):
+        if now is None:
+            now = timer()
+        elapsed = now - self.start
+        rate = self.count / elapsed if elapsed > 0 else 0.0
+        if self.total:
+            msg = "%d/%d records (%.1f%%)" % (self.count, self.total, 100.0 * self.count / self.total)
+        else:
+            msg = "%d records" % self.count
+        msg += ", %.1f/s, %s elapsed" % (rate, _format_seconds(elapsed))
+        if self.total and rate and not final:
+            msg += ", ETA %s" % _format_seconds((self.total - self.count) / rate)
+        print(msg, file=self.stream)
+        self.stream.flush()
+
+    def finish(self):
+        self.report(final=True)
+
+def _format_seconds(value):
+    value = int(value)
+    return "%d:%02d:%02d" % (value // 3600, value // 60 % 60, value % 60)
+
+#=============================================================================
+# record formats
+#=============================================================================
+def _read_records(stream, format, key_field, secret_field):
+    """yield ``(key, secret)`` pairs from stream; key defaults to 1-based record number"""
+    if format == "csv":
+        rows = csv.DictReader(stream)
+    else:
+        rows = (json.loads(line) for line in stream if line.strip())
+    for idx, row in enumerate(rows, 1):
+        try:
+            secret = row[secret_field]
+            key = row[key_field] if key_field else idx
+        except (KeyError, TypeError) as err:
+            raise ValueError("record %d: missing field %s" % (idx, err))
+        yield key, secret
+
+class _RecordWriter(object):
+    """writes ``(key, hash)`` pairs to stream"""
+    def __init__(self, stream, format, key_field, hash_field):
+        self.stream = stream
+        self.format = format
+        self.key_field = key_field
+        self.hash_field = hash_field
+        if format == "csv":
+            self._writer = csv.writer(stream)
+            self._writer.writerow([key_field, hash_field])
+
+    def write(self, key, hash):
+        if self.format == "csv":
+            self._writer.writerow([key, hash])
+        else:
+            self.stream.write(json.dumps({self.key_field: key, self.hash_field: hash}) + "\n")
+
+def _count_records(path, format):
+    """count records in file (used to calculate ETA)"""
+    with _open_text(path, "r") as fh:
+        if format == "csv":
+            # NOTE: uses same reader as _read_records(), since quoted fields may contain newlines
+            return sum(1 for _ in csv.DictReader(fh))
+        return sum(1 for line in fh if line.strip())
+
+def _open_text(path, mode):
+    if PY2: # pragma: no cover
+        return open(path, mode + "b")
+    return io.open(path, mode, encoding="utf-8", newline="")
+
+def _guess_format(path):
+    if path and path.lower().endswith(".csv"):
+        return "csv"
+    return "jsonl"
+
+#=============================================================================
+# command line interface
+#=============================================================================
+def main(args=None):
+    """command line entry point"""
+    import argparse
+    parser = argparse.ArgumentParser(
+        prog="python -m passlib.bulk",
+        description="Hash passwords from a CSV or JSON-lines file in parallel. "
+                    "Output contains only each record's key and hash.")
+    parser.add_argument("input", nargs="?", default="-",
+                        help="input file (defaults to stdin)")
+    parser.add_argument("-o", "--output", default="-",
+                        help="output file (defaults to stdout)")
+    parser.add_argument("-f", "--format", choices=["csv", "jsonl"],
+                        help="input & output format (guessed from input filename, defaults to jsonl)")
+    source = parser.add_mutually_exclusive_group(required=True)
+    source.add_argument("-c", "--config", help="CryptContext INI file to use")
+    source.add_argument("-s", "--scheme", help="name of hash scheme to use")
+    parser.add_argument("--section", default="passlib", help="INI section of config file")
+    parser.add_argument("-k", "--key-field",
+                        help="input field identifying the record (defaults to record number)")
+    parser.add_argument("-p", "--secret-field", default="password",
+                        help="input field holding the password (default: %(default)s)")
+    parser.add_argument("--hash-field", default="hash",
+                        help="output field for the hash (default: %(default)s)")
+    parser.add_argument("-j", "--workers", type=int, default=None,
+                        help="number of workers (defaults to number of cpus)")
+    pool = parser.add_mutually_exclusive_group()
+    pool.add_argument("--threads", dest="pool", action="store_const", const=False,
+                      default=True, help="use threads instead of processes")
+    pool.add_argument("--interpreters", dest="pool", action="store_const",
+                      const="interpreters",
+                      help="use sub-interpreters instead of processes (Python 3.14+)")
+    parser.add_argument("--chunk-size", type=int, default=64,
+                        help="records per work unit (default: %(default)s)")
+    parser.add_argument("-q", "--quiet", action="store_true",
+                        help="don't report progress")
+    opts = parser.parse_args(args)
+
+    if opts.pool == "interpreters" and _interpreters is None:
+        print("error: --interpreters requires Python 3.14+", file=sys.stderr)
+        return 1
+
+    try:
+        if opts.config:
+            context = CryptContext.from_path(opts.config, section=opts.section)
+        else:
+            context = CryptContext([opts.scheme])
+    except (KeyError, ValueError) as err:
+        # NOTE: using err.args[0], since str(KeyError) adds quotes
+        parser.error(err.args[0] if err.args else str(err))
+    format = opts.format or _guess_format(opts.input if opts.input != "-" else opts.output)
+
+    progress = None
+    if not opts.quiet:
+        total = None
+        if opts.input != "-" and os.path.isfile(opts.input):
+            total = _count_records(opts.input, format)
+        progress = ProgressReporter(total)
+
+    infile = sys.stdin if opts.input == "-" else _open_text(opts.input, "r")
+    outfile = None
+    try:
+        records = _read_records(infile, format, opts.key_field, opts.secret_field)
+        # NOTE: arguments are checked before output file is opened (and truncated)
+        results = hash_records(context, records, workers=opts.workers,
+                               processes=opts.pool,
+                               chunk_size=opts.chunk_size, progress=progress)
+        outfile = sys.stdout if opts.output == "-" else _open_text(opts.output, "w")
+        writer = _RecordWriter(outfile, format, opts.key_field or "record", opts.hash_field)
+        for key, hash in results:
+            writer.write(key, hash)
+    except ValueError as err:
+        print("error: %s" % (err,), file=sys.stderr)
+        return 1
+    finally:
+        if infile is not sys.stdin:
+            infile.close()
+        if outfile is sys.stdout:
+            outfile.flush()
+        elif outfile is not None:
+            outfile.close()
+    if progress:
+        progress.finish()
+    return 0
+
+if __name__ == "__main__":
+    sys.exit(main())
+
+#=============================================================================
+# eof
+#=============================================================================
@@ -4,22 +4,26 @@
 #=============================================================================
 # core
 from __future__ import absolute_import, division, print_function
+from collections import deque
 import re
 import logging; log = logging.getLogger(__name__)
+import os
 import threading
 import time
 from warnings import warn
 # site
 # pkg
-from passlib.exc import ExpectedStringError, ExpectedTypeError, PasslibConfigWarning
+from passlib.exc import ExpectedStringError, ExpectedTypeError, MissingBackendError, \
+    PasslibConfigWarning
 from passlib.registry import get_crypt_handler, _validate_handler_name
 from passlib.utils import (handlers as uh, to_bytes,
                            to_unicode, splitcomma,
                            as_bool, timer, rng, getrandstr,
+                           imap_ordered,
                            )
 from passlib.utils.binary import BASE64_CHARS
-from passlib.utils.compat import (iteritems, num_types, irange,
-                                  PY2, PY3, unicode, SafeConfigParser,
+from passlib.utils.compat import (iteritems, num_types, irange, imap,
+                                  PY2, PY3, unicode, SafeConfigParser, OrderedDict,
                                   NativeStringIO, BytesIO,
                                   unicode_or_bytes_types, native_string_types,
                                   )
@@ -27,7 +31,10 @@ from passlib.utils.decor import deprecated_method, memoized_property
 # local
 __all__ = [
     'CryptContext',
+    'DeferredUpdater',
     'LazyCryptContext',
+    'ReloadingCryptContext',
+    'VerifyTracer',
 ]
 
 #=============================================================================
@@ -124,6 +131,10 @@ class _CryptConfig(object):
     # in order of schemes(). populated on demand by _get_record_list()
     _record_lists = None
 
+    # hash of CryptContext._dummy_secret under this config, for dummy_verify().
+    # populated on demand (or before config is made active, by ReloadingCryptContext)
+    dummy_hash = None
+
     #===================================================================
     # constructor
     #===================================================================
@@ -132,6 +143,9 @@ class _CryptConfig(object):
         self._init_options(source)
         self._init_default_schemes()
         self._init_records()
+        if not self.context_kwds:
+            # disable method for this instance, it's not needed.
+            self.strip_unused_context_kwds = None
 
     def _init_scheme_list(self, data):
         """initialize .handlers and .schemes attributes"""
@@ -224,9 +238,9 @@ class _CryptConfig(object):
                         option_map[key] = value
             else:
                 # normalize context option
-                if cat and key == "schemes":
-                    raise KeyError("'schemes' context option is not allowed "
-                                   "per category")
+                if cat and key in ("schemes", "compile"):
+                    raise KeyError("%r context option is not allowed "
+                                   "per category" % (key,))
                 key, value = norm_context_option(cat, key, value)
 
                 # store in context_options
@@ -282,6 +296,8 @@ class _CryptConfig(object):
                     if scheme not in schemes:
                         raise KeyError("deprecated scheme not found "
                                    "in policy: %r" % (scheme,))
+        elif key == "compile":
+            value = as_bool(value, param="compile")
         elif key != "schemes":
             raise KeyError("unknown CryptContext keyword: %r" % (key,))
         return key, value
@@ -469,13 +485,17 @@ class _CryptConfig(object):
         all_context_kwds = self.context_kwds = set()
         get_options = self._get_record_options_with_flag
         categories = (None,) + self.categories
+        compile = self.get_context_optionmap("compile").get(None)
         for handler in self.handlers:
             scheme = handler.name
             all_context_kwds.update(handler.context_kwds)
             for cat in categories:
                 kwds, has_cat_options = get_options(scheme, cat)
                 if cat is None or has_cat_options:
-                    records[scheme, cat] = self._create_record(handler, cat, **kwds)
+                    record = self._create_record(handler, cat, **kwds)
+                    if compile:
+                        record = self._compile_record(record)
+                    records[scheme, cat] = record
                 # NOTE: if handler has no category-specific opts, get_record()
                 # will automatically use the default category's record.
         # NOTE: default records for specific category stored under the
@@ -505,6 +525,17 @@ class _CryptConfig(object):
         subcls.deprecated = deprecated  # attr reserved for this purpose
         return subcls
 
+    @staticmethod
+    def _compile_record(record):
+        """
+        replace record with specialized version whose settings are treated as constant
+        (used when ``compile=True`` is set).  records which don't support this are returned as-is.
+        """
+        compile = getattr(record, "_compile", None)
+        if compile is None:
+            return record
+        return compile()
+
     def _get_record_options_with_flag(self, scheme, category):
         """return composite dict of options for given scheme + category.
 
@@ -617,6 +648,32 @@ class _CryptConfig(object):
         else:
             raise ValueError("hash could not be identified")
 
+    def get_or_identify_record(self, hash, scheme=None, category=None):
+        """return record based on scheme, or failing that, by identifying hash"""
+        if scheme:
+            if not isinstance(hash, unicode_or_bytes_types):
+                raise ExpectedStringError(hash, "hash")
+            return self.get_record(scheme, category)
+        else:
+            # hash typecheck handled by identify_record()
+            return self.identify_record(hash, category)
+
+    def strip_unused_context_kwds(self, kwds, record):
+        """
+        helper which removes any context keywords from **kwds**
+        that are known to be used by another scheme in this config,
+        but are NOT supported by handler specified by **record**.
+
+        .. note::
+            as optimization, this method is set to None on a per-instance basis
+            if there are no context kwds.
+        """
+        if not kwds:
+            return
+        unused_kwds = self.context_kwds.difference(record.context_kwds)
+        for key in unused_kwds:
+            kwds.pop(key, None)
+
     @memoized_property
     def disabled_record(self):
         for record in self._get_record_list(None):
@@ -715,12 +772,14 @@ class CryptContext(object):
     # instance attrs
     #===================================================================
 
-    # _CryptConfig instance holding current parsed config
+    # _CryptConfig instance holding current parsed config.
+    # NOTE: this is the only per-config state stored on the context,
+    #       so replacing it is a single (atomic) assignment; and methods read it once per call,
+    #       so they see a consistent snapshot even if the config is replaced concurrently.
     _config = None
 
-    # copy of _config methods, stored in CryptContext instance for speed.
-    _get_record = None
-    _identify_record = None
+    # VerifyTracer installed by trace(), if any
+    _tracer = None
 
     #===================================================================
     # secondary constructors
@@ -907,9 +966,13 @@ class CryptContext(object):
 
         .. versionadded:: 1.6
         """
-        def helper(stream):
-            kwds = self._parse_ini_stream(stream, section, path)
-            return self.load(kwds, update=update)
+        kwds = self._read_ini_path(path, section, encoding)
+        return self.load(kwds, update=update)
+
+    @classmethod
+    def _read_ini_path(cls, path, section, encoding):
+        """helper read INI file from local path, extract passlib section as dict"""
+        helper = lambda stream: cls._parse_ini_stream(stream, section, path)
         if PY3:
             # decode to unicode, which load() expected under py3
             with open(path, "rt", encoding=encoding) as stream:
@@ -981,6 +1044,16 @@ class CryptContext(object):
 
         .. versionadded:: 1.6
         """
+        config = self._build_config(source, update, section, encoding)
+        if config is not None:
+            self._set_config(config)
+
+    def _build_config(self, source, update=False, section="passlib", encoding="utf-8"):
+        """
+        helper for load() -- parses *source* into a new :class:`_CryptConfig`
+        instance, without altering the state of the context.
+        returns ``None`` if *update* is set, and there's nothing to update.
+        """
         #-----------------------------------------------------------
         # autodetect source type, convert to dict
         #-----------------------------------------------------------
@@ -1014,26 +1087,27 @@ class CryptContext(object):
         if update and self._config is not None:
             # if updating, do nothing if source is empty,
             if not source:
-                return
+                return None
             # otherwise overlay source on top of existing config
             tmp = source
             source = dict(self._config.iter_config(resolve=True))
             source.update(tmp)
 
         #-----------------------------------------------------------
-        # compile into _CryptConfig instance, and update state
+        # compile into _CryptConfig instance
         #-----------------------------------------------------------
-        config = _CryptConfig(source)
+        return _CryptConfig(source)
+
+    def _set_config(self, config):
+        """
+        helper for load() -- make *config* the active configuration.
+
+        everything derived from the configuration (including the :meth:`dummy_verify` hash)
+        lives on *config* itself, so this is a single attribute assignment;
+        concurrent callers see either the old or the new configuration,
+        and never a partially-updated one.
+        """
         self._config = config
-        self._reset_dummy_verify()
-        self._get_record = config.get_record
-        self._identify_record = config.identify_record
-        if config.context_kwds:
-            # (re-)enable method for this instance (in case ELSE clause below ran last load).
-            self.__dict__.pop("_strip_unused_context_kwds", None)
-        else:
-            # disable method for this instance, it's not needed.
-            self._strip_unused_context_kwds = None
 
     @staticmethod
     def _parse_config_key(ckey):
@@ -1427,36 +1501,16 @@ class CryptContext(object):
     #       The custom handlers are cached inside the _CryptConfig
     #       instance stored in self._config, and are retrieved
     #       via get_record() and identify_record().
-    #
-    #       _get_record() and _identify_record() are references
-    #       to _config methods of the same name,
-    #       stored in CryptContext for speed.
+    #       Each method reads self._config once, and uses that snapshot throughout,
+    #       since ReloadingCryptContext may replace it at any time.
 
-    def _get_or_identify_record(self, hash, scheme=None, category=None):
-        """return record based on scheme, or failing that, by identifying hash"""
-        if scheme:
-            if not isinstance(hash, unicode_or_bytes_types):
-                raise ExpectedStringError(hash, "hash")
-            return self._get_record(scheme, category)
-        else:
-            # hash typecheck handled by identify_record()
-            return self._identify_record(hash, category)
+    def _get_record(self, scheme, category):
+        """return record for scheme & category under current config"""
+        return self._config.get_record(scheme, category)
 
-    def _strip_unused_context_kwds(self, kwds, record):
-        """
-        helper which removes any context keywords from **kwds**
-        that are known to be used by another scheme in this context,
-        but are NOT supported by handler specified by **record**.
-
-        .. note::
-            as optimization, load() will set this method to None on a per-instance basis
-            if there are no context kwds.
-        """
-        if not kwds:
-            return
-        unused_kwds = self._config.context_kwds.difference(record.context_kwds)
-        for key in unused_kwds:
-            kwds.pop(key, None)
+    def _identify_record(self, hash, category, required=True):
+        """return record which identifies hash under current config"""
+        return self._config.identify_record(hash, category, required)
 
     def needs_update(self, hash, scheme=None, category=None, secret=None):
         """Check if hash needs to be replaced for some reason,
@@ -1524,7 +1578,7 @@ class CryptContext(object):
             warn("CryptContext.needs_update(): 'scheme' keyword is deprecated as of "
                  "Passlib 1.7, and will be removed in Passlib 2.0",
                  DeprecationWarning)
-        record = self._get_or_identify_record(hash, scheme, category)
+        record = self._config.get_or_identify_record(hash, scheme, category)
         return record.deprecated or record.needs_update(hash, secret=secret)
 
     @deprecated_method(deprecated="1.6", removed="2.0", replacement="CryptContext.needs_update()")
@@ -1547,8 +1601,9 @@ class CryptContext(object):
             This method will be removed in version 2.0, and should only
             be used for compatibility with Passlib 1.3 - 1.6.
         """
-        record = self._get_record(scheme, category)
-        strip_unused = self._strip_unused_context_kwds
+        config = self._config
+        record = config.get_record(scheme, category)
+        strip_unused = config.strip_unused_context_kwds
         if strip_unused:
             strip_unused(settings, record)
         return record.genconfig(**settings)
@@ -1562,8 +1617,9 @@ class CryptContext(object):
             This method will be removed in version 2.0, and should only
             be used for compatibility with Passlib 1.3 - 1.6.
         """
-        record = self._get_or_identify_record(config, scheme, category)
-        strip_unused = self._strip_unused_context_kwds
+        snapshot = self._config
+        record = snapshot.get_or_identify_record(config, scheme, category)
+        strip_unused = snapshot.strip_unused_context_kwds
         if strip_unused:
             strip_unused(kwds, record)
         return record.genhash(secret, config, **kwds)
@@ -1602,7 +1658,7 @@ class CryptContext(object):
             The handler which first identifies the hash,
             or ``None`` if none of the algorithms identify the hash.
         """
-        record = self._identify_record(hash, category, required)
+        record = self._config.identify_record(hash, category, required)
         if record is None:
             return None
         elif resolve:
@@ -1663,8 +1719,9 @@ class CryptContext(object):
             warn("CryptContext.hash(): 'scheme' keyword is deprecated as of "
                  "Passlib 1.7, and will be removed in Passlib 2.0",
                  DeprecationWarning)
-        record = self._get_record(scheme, category)
-        strip_unused = self._strip_unused_context_kwds
+        config = self._config
+        record = config.get_record(scheme, category)
+        strip_unused = config.strip_unused_context_kwds
         if strip_unused:
             strip_unused(kwds, record)
         return record.hash(secret, **kwds)
@@ -1747,16 +1804,54 @@ class CryptContext(object):
             warn("CryptContext.verify(): 'scheme' keyword is deprecated as of "
                  "Passlib 1.7, and will be removed in Passlib 2.0",
                  DeprecationWarning)
+        config = self._config
+        tracer = self._tracer
+        if tracer is None:
+            return self._verify_record(secret, hash, scheme, category, kwds, config)[1]
+        with _TraceSpan(tracer, "verify") as span:
+            return self._verify_record(secret, hash, scheme, category, kwds, config, span)[1]
+
+    def _verify_record(self, secret, hash, scheme, category, kwds, config, span=None):
+        """
+        helper for verify() & _verify_and_check() -- identifies hash under *config*,
+        and verifies secret against it; returns ``(record, valid)``.
+        if *span* is provided (see :meth:`trace`), the scheme, backend,
+        and the time spent in each phase are recorded in it.
+        """
         if hash is None:
             # convenience feature -- let apps pass in hash=None when user
             # isn't found / has no hash; useful because it invokes dummy_verify()
-            self.dummy_verify()
-            return False
-        record = self._get_or_identify_record(hash, scheme, category)
-        strip_unused = self._strip_unused_context_kwds
-        if strip_unused:
+            self._verify_record(self._dummy_secret, self._get_dummy_hash(config),
+                                None, None, {}, config, span)
+            if span is not None:
+                span.attrs["passlib.verified"] = False
+            return None, False
+        if span is not None:
+            start = timer()
+        record = config.get_or_identify_record(hash, scheme, category)
+        strip_unused = config.strip_unused_context_kwds
+        if strip_unused and kwds:
+            kwds = kwds.copy()
             strip_unused(kwds, record)
-        return record.verify(secret, hash, **kwds)
+        if span is None:
+            return record, record.verify(secret, hash, **kwds)
+        identified = timer()
+        phases = span.phases
+        phases["identify"] = identified - start
+        span.attrs["passlib.scheme"] = record.name
+        verify_phases = getattr(record, "_verify_phases", None)
+        if verify_phases is None:
+            try:
+                valid = record.verify(secret, hash, **kwds)
+            finally:
+                phases["verify"] = timer() - identified
+        else:
+            valid = verify_phases(secret, hash, phases, **kwds)
+        get_backend = getattr(record, "get_backend", None)
+        if get_backend:
+            span.attrs["passlib.backend"] = get_backend()
+        span.attrs["passlib.verified"] = valid
+        return record, valid
 
     def verify_and_update(self, secret, hash, scheme=None, category=None, **kwds):
         """verify password and re-hash the password if needed, all in a single call.
@@ -1826,29 +1921,203 @@ class CryptContext(object):
             warn("CryptContext.verify(): 'scheme' keyword is deprecated as of "
                  "Passlib 1.7, and will be removed in Passlib 2.0",
                  DeprecationWarning)
-        if hash is None:
-            # convenience feature -- let apps pass in hash=None when user
-            # isn't found / has no hash; useful because it invokes dummy_verify()
-            self.dummy_verify()
-            return False, None
-        record = self._get_or_identify_record(hash, scheme, category)
-        strip_unused = self._strip_unused_context_kwds
-        if strip_unused and kwds:
-            clean_kwds = kwds.copy()
-            strip_unused(clean_kwds, record)
-        else:
-            clean_kwds = kwds
+        config = self._config
+        tracer = self._tracer
+        if tracer is None:
+            return self._verify_and_rehash(secret, hash, scheme, category, kwds, config)
+        with _TraceSpan(tracer, "verify_and_update") as span:
+            return self._verify_and_rehash(secret, hash, scheme, category, kwds, config, span)
+
+    def _verify_and_rehash(self, secret, hash, scheme, category, kwds, config, span=None):
+        """
+        helper for verify_and_update() -- verifies secret under *config*,
+        and returns ``(valid, new_hash)`` tuple.
+        """
+        valid, update = self._verify_and_check(secret, hash, scheme, category, kwds,
+                                               config, span)
+        if not update:
+            return valid, None
+        if span is not None:
+            start = timer()
+        # NOTE: we re-hash with default scheme, not current one.
+        record = config.get_record(None, category)
+        strip_unused = config.strip_unused_context_kwds
+        if strip_unused:
+            strip_unused(kwds, record)
+        new_hash = record.hash(secret, **kwds)
+        if span is not None:
+            span.phases["rehash"] = timer() - start
+        return True, new_hash
+
+    def _verify_and_check(self, secret, hash, scheme, category, kwds, config=None, span=None):
+        """
+        helper for verify_and_update() -- verifies secret,
+        and returns ``(valid, needs_update)`` tuple.
+        uses the current config, unless a *config* snapshot is passed in.
+        if *span* is provided, phases are recorded in it (same as :meth:`_verify_record`).
+        """
+        if config is None:
+            config = self._config
+        record, valid = self._verify_record(secret, hash, scheme, category, kwds, config, span)
+        if not valid:
+            return False, False
         # XXX: if record is default scheme, could extend PasswordHash
         #      api to combine verify & needs_update to single call,
         #      potentially saving some round-trip parsing.
         #      but might make these codepaths more complex...
-        if not record.verify(secret, hash, **clean_kwds):
-            return False, None
-        elif record.deprecated or record.needs_update(hash, secret=secret):
-            # NOTE: we re-hash with default scheme, not current one.
-            return True, self.hash(secret, category=category, **kwds)
+        if span is not None:
+            start = timer()
+        update = bool(record.deprecated or record.needs_update(hash, secret=secret))
+        if span is not None:
+            span.phases["needs_update"] = timer() - start
+        return True, update
+
+    def defer_updates(self, callback, max_pending=1024, policy="drop", workers=1):
+        """Create a :class:`DeferredUpdater` which performs the re-hashing
+        step of :meth:`verify_and_update` on background threads.
+
+        See :class:`DeferredUpdater` for a description of the arguments.
+
+        .. versionadded:: 1.8
+        """
+        return DeferredUpdater(self, callback, max_pending=max_pending,
+                               policy=policy, workers=workers)
+
+    #===================================================================
+    # tracing
+    #===================================================================
+    def trace(self, size=256, callback=None):
+        """Enable tracing of :meth:`verify` and :meth:`verify_and_update` calls.
+
+        While enabled, each call records which scheme & backend handled the hash,
+        and how long was spent in each phase: ``"identify"`` (finding the scheme),
+        ``"parse"`` (parsing the hash), ``"kdf"`` (calculating the checksum), ``"compare"``,
+        and for :meth:`verify_and_update`, ``"needs_update"`` and ``"rehash"``.
+        Hashes whose :meth:`~passlib.ifc.PasswordHash.verify` method can't be split up
+        report a single ``"verify"`` phase instead.
+
+        The phases are recorded by :meth:`verify` and :meth:`verify_and_update` themselves,
+        so tracing only costs a single attribute check when disabled.
+        Calls passing ``hash=None`` record the verify of the :meth:`dummy_verify` hash.
+
+        :param size:
+            number of records to keep in the tracer's :attr:`~VerifyTracer.records` ring buffer.
+            If ``0``, records are only passed to *callback*.
+
+        :param callback:
+            optional function which will be called with each record (from the thread which made the call).
+
+        :returns:
+            the :class:`VerifyTracer` instance, which also acts as a context manager
+            that disables tracing on exit.
+            Calling this method again replaces the current tracer.
+
+        .. versionadded:: 1.8
+        """
+        if self._tracer is not None:
+            self._tracer.close()
+        tracer = VerifyTracer(self, size=size, callback=callback)
+        self._tracer = tracer
+        return tracer
+
+    #===================================================================
+    # warmup
+    #===================================================================
+    def warmup(self, schemes=None, parallel=True):
+        """Perform the lazy setup each scheme would otherwise do on first use.
+
+        The first call to :meth:`hash` / :meth:`verify` for a scheme
+        normally pays for loading its backend (e.g. probing for the ``bcrypt`` package),
+        building internal tables (e.g. for DES & blowfish based hashes),
+        compiling helpers (e.g. the builtin pbkdf2 loop), and generating
+        the dummy hash used by :meth:`dummy_verify`.  Calling this method when
+        a worker process starts moves that cost off the first requests it serves.
+
+        :param schemes:
+            list of schemes to warm up (defaults to all schemes in the context).
+
+        :param parallel:
+            By default, schemes are warmed up concurrently using a pool of threads
+            (this mainly helps backends which release the GIL, such as ``bcrypt``).
+            If ``False``, they're processed one at a time.
+
+        :raises KeyError:
+            if any of *schemes* isn't part of this context.
+
+        :returns:
+            ordered dict mapping each scheme name -> dict containing:
+
+            * ``"backend"`` -- name of the backend that was loaded (or ``None``
+              if the hash doesn't have multiple backends).
+            * ``"steps"`` -- ordered dict mapping each step (``"backend"``, ``"hash"``, ``"verify"``,
+              and for the default scheme, ``"dummy_hash"``) -> seconds it took.
+            * ``"error"`` -- ``None``, or the error message if the scheme couldn't be loaded
+              (e.g. its backend is missing).  Errors aren't raised,
+              so they show up on first use as usual.
+
+        .. versionadded:: 1.8
+        """
+        config = self._config
+        if schemes is None:
+            schemes = config.schemes
+        records = [(scheme, config.get_record(scheme, None)) for scheme in schemes]
+        if parallel and len(records) > 1:
+            results = imap_ordered(self._warmup_record, records, workers=len(records))
         else:
-            return True, None
+            results = imap(self._warmup_record, records)
+        report = OrderedDict()
+        hashes = {}
+        for scheme, info, hash in results:
+            report[scheme] = info
+            hashes[scheme] = hash
+
+        # precalculate hash for dummy_verify() -- reusing the one generated above if possible
+        # (stored on config, same as ReloadingCryptContext._warm_config()).
+        default = config.default_scheme(None) if config.schemes else None
+        if default in report and not report[default]["error"]:
+            start = timer()
+            if config.dummy_hash is None:
+                if hashes[default] is not None:
+                    config.dummy_hash = hashes[default]
+                else:
+                    self._get_dummy_hash(config)
+            report[default]["steps"]["dummy_hash"] = timer() - start
+
+        for scheme, info in iteritems(report):
+            log.debug("warmup: %s: backend=%s, steps=%s, error=%s", scheme, info["backend"],
+                      ", ".join("%s=%.4fs" % item for item in iteritems(info["steps"])),
+                      info["error"])
+        return report
+
+    def _warmup_record(self, item):
+        """
+        helper for warmup() -- warms up single record, returning ``(scheme, info, hash)``,
+        where *hash* is a hash of the dummy secret (if one was generated without any context kwds).
+        """
+        scheme, record = item
+        steps = OrderedDict()
+        info = dict(backend=None, steps=steps, error=None)
+        secret = self._dummy_secret
+        kwds = {}
+        if "user" in record.context_kwds:
+            kwds['user'] = "user"
+        hash = None
+        try:
+            get_backend = getattr(record, "get_backend", None)
+            if get_backend:
+                start = timer()
+                info['backend'] = get_backend()
+                steps['backend'] = timer() - start
+            start = timer()
+            hash = record.hash(secret, **kwds)
+            steps['hash'] = timer() - start
+            start = timer()
+            record.verify(secret, hash, **kwds)
+            steps['verify'] = timer() - start
+        except (MissingBackendError, TypeError, ValueError) as err:
+            info['error'] = str(err)
+            hash = None
+        return scheme, info, (None if kwds else hash)
 
     #===================================================================
     # missing-user helper
@@ -1857,18 +2126,28 @@ class CryptContext(object):
     #: secret used for dummy_verify()
     _dummy_secret = "too many secrets"
 
-    @memoized_property
+    @property
     def _dummy_hash(self):
         """
         precalculated hash for dummy_verify() to use
         """
-        return self.hash(self._dummy_secret)
+        return self._get_dummy_hash(self._config)
+
+    def _get_dummy_hash(self, config):
+        """
+        return hash for dummy_verify() under *config*, calculating it on first use
+        """
+        hash = config.dummy_hash
+        if hash is None:
+            # NOTE: if threads race, each may calculate a hash; any of them will do.
+            hash = config.dummy_hash = config.get_record(None, None).hash(self._dummy_secret)
+        return hash
 
     def _reset_dummy_verify(self):
         """
         flush memoized values used by dummy_verify()
         """
-        type(self)._dummy_hash.clear_cache(self)
+        self._config.dummy_hash = None
 
     def dummy_verify(self):
         """
@@ -1880,7 +2159,9 @@ class CryptContext(object):
 
         .. versionadded:: 1.7
         """
-        self.verify(self._dummy_secret, self._dummy_hash)
+        # NOTE: verify() treats hash=None as a request to verify the dummy hash
+        #       (from the same config snapshot it uses to identify it).
+        self.verify(self._dummy_secret, None)
         return False
 
     #===================================================================
@@ -1897,7 +2178,7 @@ class CryptContext(object):
             if the hash is not recognized
             (typically solved by adding ``unix_disabled`` to the list of schemes).
         """
-        return not self._identify_record(hash, None).is_disabled
+        return not self._config.identify_record(hash, None).is_disabled
 
     def disable(self, hash=None):
         """
@@ -1937,7 +2218,7 @@ class CryptContext(object):
         :returns:
             the original hash.
         """
-        record = self._identify_record(hash, None)
+        record = self._config.identify_record(hash, None)
         if record.is_disabled:
             # XXX: should we throw error if result can't be identified by context?
             return record.enable(hash)
@@ -1949,6 +2230,332 @@ class CryptContext(object):
     # eoc
     #===================================================================
 
+class DeferredUpdater(object):
+    """Helper which moves the re-hashing step of
+    :meth:`CryptContext.verify_and_update` off of the login path.
+
+    When a hash needs updating, :meth:`CryptContext.verify_and_update`
+    has to hash the password a second time (using the new default scheme)
+    before it can return -- roughly doubling the latency of that login.
+    This class instead returns as soon as the password has been verified,
+    and queues the re-hash for a pool of background threads,
+    which will pass the result to *callback*.
+
+    Instances are normally created via :meth:`CryptContext.defer_updates`.
+
+    :arg context:
+        :class:`CryptContext` to use. New hashes are generated using
+        its configuration at the time the re-hash runs.
+
+    :arg callback:
+        Function with the signature ``callback(user_ref, old_hash, new_hash)``,
+        which will be invoked from a background thread to persist the new hash.
+        ``user_ref`` is whatever value was passed to :meth:`verify_and_update`,
+        and ``old_hash`` is the hash the password was verified against.
+        Any errors raised by the callback are logged and discarded.
+
+        Since the user may have changed their password while the re-hash was pending,
+        the callback should only store ``new_hash`` if the account's hash
+        still equals ``old_hash`` (e.g. ``UPDATE ... SET hash = :new WHERE id = :ref AND hash = :old``).
+
+    :type max_pending: int
+    :param max_pending:
+        Maximum number of re-hashes which may be queued (default 1024).
+
+    :type policy: str
+    :param policy:
+        What to do when the queue is full. One of:
+
+        * ``"drop"`` (the default) -- discard the re-hash.
+          The hash will still need updating, so this will be retried
+          the next time the user logs in. Dropped re-hashes are counted
+          in the :attr:`dropped` attribute.
+
+        * ``"block"`` -- block the caller until there's room in the queue.
+
+    :type workers: int
+    :param workers:
+        Number of background threads to use (default 1).
+        These are started on first use, and run as daemon threads.
+
+    .. warning::
+
+        Queued re-hashes hold a reference to the plaintext password until
+        they are processed. Call :meth:`close` during application shutdown
+        so pending re-hashes are completed (and their secrets released).
+
+    .. versionadded:: 1.8
+    """
+    #===================================================================
+    # instance attrs
+    #===================================================================
+
+    #: number of re-hashes discarded because queue was full (under ``policy="drop"``)
+    dropped = 0
+
+    #: number of re-hashes which have been processed (including ones which failed)
+    completed = 0
+
+    # pending tasks, and condition guarding all mutable state
+    _queue = None
+    _cond = None
+
+    # number of tasks currently being processed by workers
+    _active = 0
+
+    # list of worker threads
+    _threads = None
+
+    # set by close()
+    _closed = False
+
+    #===================================================================
+    # init
+    #===================================================================
+    def __init__(self, context, callback, max_pending=1024, policy="drop", workers=1):
+        if not callable(callback):
+            raise ExpectedTypeError(callback, "callable", "callback")
+        if policy not in ("drop", "block"):
+            raise ValueError("policy must be 'drop' or 'block': %r" % (policy,))
+        if max_pending < 1:
+            raise ValueError("max_pending must be >= 1")
+        if workers < 1:
+            raise ValueError("workers must be >= 1")
+        self.context = context
+        self.callback = callback
+        self.max_pending = max_pending
+        self.policy = policy
+        self.workers = workers
+        self._queue = deque()
+        self._cond = threading.Condition()
+        self._threads = []
+
+    def __repr__(self):
+        return "<DeferredUpdater at 0x%0x>" % id(self)
+
+    #===================================================================
+    # public api
+    #===================================================================
+    @property
+    def pending(self):
+        """number of re-hashes which are queued or in progress"""
+        return len(self._queue) + self._active
+
+    def verify_and_update(self, secret, hash, user_ref, category=None, **kwds):
+        """verify password, and queue re-hash of the password if needed.
+
+        This behaves the same as :meth:`CryptContext.verify_and_update`,
+        except that the replacement hash (if any) will be passed to
+        ``callback(user_ref, hash, new_hash)`` at some later point.
+
+        :arg user_ref:
+            value passed through to the callback, to identify the account
+            being updated (e.g. the user id).
+
+        :returns:
+            ``True`` if the password matched the hash, else ``False``.
+        """
+        valid, update = self.context._verify_and_check(secret, hash, None, category, kwds)
+        if update:
+            self._submit((secret, hash, user_ref, category, kwds))
+        return valid
+
+    def join(self):
+        """block until all pending re-hashes have completed"""
+        with self._cond:
+            while self._queue or self._active:
+                self._cond.wait()
+
+    def close(self, wait=True):
+        """stop accepting new re-hashes, and shut down worker threads.
+
+        :param wait:
+            if ``True`` (the default), waits for pending re-hashes to complete.
+            Otherwise they are discarded.
+        """
+        with self._cond:
+            self._closed = True
+            if not wait:
+                self.dropped += len(self._queue)
+                self._queue.clear()
+            self._cond.notify_all()
+        for thread in self._threads:
+            thread.join()
+        del self._threads[:]
+
+    #===================================================================
+    # internal helpers
+    #===================================================================
+    def _submit(self, task):
+        """add task to queue, applying queue policy"""
+        with self._cond:
+            if self._closed:
+                raise RuntimeError("%r has been closed" % self)
+            queue = self._queue
+            while len(queue) >= self.max_pending:
+                if self.policy == "drop":
+                    self.dropped += 1
+                    return
+                self._cond.wait()
+                if self._closed:
+                    raise RuntimeError("%r has been closed" % self)
+            queue.append(task)
+            if len(self._threads) < self.workers:
+                self._start_worker()
+            self._cond.notify_all()
+
+    def _start_worker(self):
+        """start new worker thread (must hold lock)"""
+        thread = threading.Thread(target=self._worker, name="passlib-deferred-updater")
+        thread.daemon = True
+        thread.start()
+        self._threads.append(thread)
+
+    def _worker(self):
+        """worker thread main loop"""
+        cond = self._cond
+        queue = self._queue
+        hash = self.context.hash
+        callback = self.callback
+        while True:
+            with cond:
+                while not queue:
+                    if self._closed:
+                        return
+                    cond.wait()
+                secret, old_hash, user_ref, category, kwds = queue.popleft()
+                self._active += 1
+                # wake up any producers blocked by full queue
+                cond.notify_all()
+            try:
+                try:
+                    new_hash = hash(secret, category=category, **kwds)
+                    callback(user_ref, old_hash, new_hash)
+                except Exception:
+                    log.error("%r: failed to update hash for %r", self, user_ref,
+                              exc_info=True)
+            finally:
+                # don't keep plaintext around while idle
+                secret = kwds = None
+                with cond:
+                    self._active -= 1
+                    self.completed += 1
+                    cond.notify_all()
+
+    #===================================================================
+    # eoc
+    #===================================================================
+
+class VerifyTracer(object):
+    """Records per-phase timings of :class:`CryptContext` verify calls.
+
+    Instances are created (and tracing enabled) via :meth:`CryptContext.trace`.
+
+    Each record is a dict shaped like an OpenTelemetry span, so *callback*
+    can pass it straight on to a tracing library
+    (e.g. ``tracer.start_span(rec["name"], start_time=rec["start_time"], attributes=rec["attributes"]).end(rec["end_time"])``):
+
+    * ``"name"`` -- ``"passlib.verify"`` or ``"passlib.verify_and_update"``.
+    * ``"start_time"``, ``"end_time"`` -- integer nanoseconds since the epoch.
+    * ``"attributes"`` -- dict containing ``"passlib.scheme"`` & ``"passlib.backend"``
+      (``None`` if not known), ``"passlib.verified"`` (``None`` if the call failed),
+      ``"passlib.error"`` (only present if the call raised an error),
+      and a :samp:`"passlib.phase.{name}"` key for each phase, giving its duration in seconds.
+
+    .. attribute:: records
+
+        :class:`!collections.deque` holding the most recent records
+        (or ``None`` if created with ``size=0``).
+
+    .. versionadded:: 1.8
+    """
+    #===================================================================
+    # instance attrs
+    #===================================================================
+
+    #: context being traced
+    context = None
+
+    #: optional callback
+    callback = None
+
+    #: ring buffer of recent records
+    records = None
+
+    #===================================================================
+    # init
+    #===================================================================
+    def __init__(self, context, size=256, callback=None):
+        self.context = context
+        self.callback = callback
+        if size:
+            self.records = deque(maxlen=size)
+
+    def __repr__(self):
+        return "<VerifyTracer 0x%0x context=%r>" % (id(self), self.context)
+
+    def close(self):
+        """Disable tracing (if this is still the context's active tracer)"""
+        context = self.context
+        if context._tracer is self:
+            context._tracer = None
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc_info):
+        self.close()
+
+    #===================================================================
+    # helpers
+    #===================================================================
+    def _emit(self, record):
+        """store record & pass it to callback"""
+        records = self.records
+        if records is not None:
+            records.append(record)
+        callback = self.callback
+        if callback is not None:
+            try:
+                callback(record)
+            except Exception:
+                # don't let a broken exporter fail logins
+                log.error("%r: trace callback failed", self, exc_info=True)
+
+    #===================================================================
+    # eoc
+    #===================================================================
+
+class _TraceSpan(object):
+    """
+    helper for :meth:`CryptContext.trace` -- created by :meth:`CryptContext.verify`
+    & :meth:`CryptContext.verify_and_update` for each traced call, and passed
+    down to their helpers, which record the scheme, backend, & phase timings in it.
+    emits record to tracer on exit.
+    """
+    def __init__(self, tracer, name):
+        self.tracer = tracer
+        self.name = name
+        self.phases = OrderedDict()
+        self.attrs = OrderedDict([("passlib.scheme", None), ("passlib.backend", None),
+                                  ("passlib.verified", None)])
+
+    def __enter__(self):
+        self.start_time = int(time.time() * 1e9)
+        self.start = timer()
+        return self
+
+    def __exit__(self, exc_type, exc_value, traceback):
+        elapsed = timer() - self.start
+        attrs = self.attrs
+        if exc_type is not None:
+            attrs["passlib.error"] = "%s: %s" % (exc_type.__name__, exc_value)
+        for phase, value in iteritems(self.phases):
+            attrs["passlib.phase." + phase] = value
+        self.tracer._emit(dict(name="passlib." + self.name, start_time=self.start_time,
+                               end_time=self.start_time + int(elapsed * 1e9),
+                               attributes=attrs))
+
 class LazyCryptContext(CryptContext):
     """CryptContext subclass which doesn't load handlers until needed.
 
@@ -2020,6 +2627,196 @@ class LazyCryptContext(CryptContext):
                 self._lazy_init()
         return object.__getattribute__(self, attr)
 
+class ReloadingCryptContext(CryptContext):
+    """CryptContext subclass which reloads its configuration when its source changes.
+
+    This is a subclass of CryptContext whose configuration is pulled from an
+    external *source*, and which can be safely reloaded while other threads
+    are using the context. Each reload parses the new configuration, creates
+    the handler records, loads their backends, and precalculates the
+    :meth:`~CryptContext.dummy_verify` hash -- all before the new configuration
+    is made active. The switch itself is a single assignment, so
+    :meth:`~CryptContext.verify` et al never block, and never see a half-loaded
+    configuration.
+
+    :arg source:
+        Source of the configuration. This can be either:
+
+        * the path to a local INI-formatted file, which will be reloaded
+          whenever its modification time or size changes.
+
+        * a callable, with the signature ``source() -> config``, where ``config``
+          is any value accepted by :meth:`CryptContext.load`. The configuration
+          will be reloaded whenever the returned value differs (via ``!=``)
+          from the one previously loaded.
+
+    :param section:
+        INI section to read the configuration from (defaults to ``"passlib"``).
+
+    :param encoding:
+        Encoding to use when reading an INI file (defaults to ``"utf-8"``).
+
+    :type interval: float
+    :param interval:
+        If specified, :meth:`start` is invoked with this interval,
+        so the source is watched by a background thread.
+
+    If the source is invalid when first loaded, the constructor will raise an error.
+    If it's invalid on a later reload, the previous configuration remains active.
+
+    .. versionadded:: 1.8
+    """
+    #===================================================================
+    # instance attrs
+    #===================================================================
+
+    #: source of configuration
+    source = None
+
+    #: token identifying last loaded version of source
+    _source_token = None
+
+    #: background watcher thread & its stop flag
+    _watcher = None
+    _watcher_stop = None
+
+    def __init__(self, source, section="passlib", encoding="utf-8", interval=None):
+        if not (isinstance(source, native_string_types) or callable(source)):
+            raise ExpectedTypeError(source, "path or callable", "source")
+        self.source = source
+        self.section = section
+        self.encoding = encoding
+        self._reload_lock = threading.Lock()
+        super(ReloadingCryptContext, self).__init__(_autoload=False)
+        self.reload()
+        if interval is not None:
+            self.start(interval)
+
+    def __repr__(self):
+        return "<ReloadingCryptContext at 0x%0x>" % id(self)
+
+    #===================================================================
+    # reloading
+    #===================================================================
+    def _read_source(self):
+        """helper which returns ``(token, config)`` for the current source"""
+        source = self.source
+        if callable(source):
+            config = source()
+            return config, config
+        else:
+            # NOTE: stat'ing before reading, so a write that races with the read
+            #       will show up as a new token on the next check.
+            stat = os.stat(source)
+            return ((stat.st_mtime, stat.st_size),
+                    self._read_ini_path(source, self.section, self.encoding))
+
+    def _source_changed(self):
+        """helper which cheaply checks if source *might* have changed"""
+        source = self.source
+        if callable(source):
+            # have to invoke callable to find out.
+            return True
+        stat = os.stat(source)
+        return (stat.st_mtime, stat.st_size) != self._source_token
+
+    def _warm_config(self, config):
+        """
+        helper which performs all the lazy setup of a new config,
+        so the first calls after it's made active don't pay for it.
+        """
+        # load the backends of all the handlers.
+        for record in set(config._records.values()):
+            get_backend = getattr(record, "get_backend", None)
+            if get_backend:
+                try:
+                    get_backend()
+                except MissingBackendError:
+                    # leave error for the first call that actually needs this scheme.
+                    pass
+
+        # precalculate hash for dummy_verify()
+        try:
+            self._get_dummy_hash(config)
+        except (TypeError, ValueError):
+            # default scheme needs context kwds (e.g. 'user'),
+            # dummy_verify() will raise same error as it normally does.
+            pass
+
+    def reload(self, force=True):
+        """Reload configuration from :attr:`source`.
+
+        :param force:
+            By default, the configuration is always reloaded.
+            If ``force=False``, it will only be reloaded if the source has changed.
+
+        :raises TypeError, ValueError:
+            If the new configuration is invalid.
+            The previous configuration will remain active in this case.
+
+        :returns:
+            ``True`` if a new configuration was loaded, ``False`` otherwise.
+        """
+        with self._reload_lock:
+            if not force and not self._source_changed():
+                return False
+            token, source = self._read_source()
+            if not force and token == self._source_token:
+                return False
+            config = self._build_config(source, section=self.section,
+                                        encoding=self.encoding)
+            self._warm_config(config)
+            self._set_config(config)
+            self._source_token = token
+        log.debug("%r: loaded new configuration from %r", self, self.source)
+        return True
+
+    def reload_if_changed(self):
+        """Reload configuration only if :attr:`source` has changed since the last load.
+        This is an alias for ``reload(force=False)``.
+        """
+        return self.reload(force=False)
+
+    #===================================================================
+    # background watcher
+    #===================================================================
+    def start(self, interval=30):
+        """Start background thread which calls :meth:`reload_if_changed`
+        every *interval* seconds. Errors encountered while reloading are logged,
+        and the previous configuration is kept.
+        """
+        if interval <= 0:
+            raise ValueError("interval must be > 0")
+        if self._watcher is not None:
+            raise RuntimeError("%r: watcher already running" % self)
+        stop = self._watcher_stop = threading.Event()
+
+        def watcher():
+            while not stop.wait(interval):
+                try:
+                    self.reload_if_changed()
+                except Exception:
+                    log.warning("%r: failed to reload configuration from %r",
+                                self, self.source, exc_info=True)
+
+        thread = self._watcher = threading.Thread(target=watcher,
+                                                  name="passlib-context-watcher")
+        thread.daemon = True
+        thread.start()
+
+    def stop(self, timeout=None):
+        """Stop background thread started by :meth:`start` (if running)"""
+        thread = self._watcher
+        if thread is None:
+            return
+        self._watcher_stop.set()
+        thread.join(timeout)
+        self._watcher = self._watcher_stop = None
+
+    #===================================================================
+    # eoc
+    #===================================================================
+
 #=============================================================================
 # eof
 #=============================================================================
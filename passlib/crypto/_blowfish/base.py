@@ -22,19 +22,23 @@ def _init_constants():
     # NOTE: blowfish's spec states these numbers are the hex representation
     # of the fractional portion of PI, in order.
 
+    # NOTE: these are stored as (nested) tuples of literals, which python folds into
+    # constants of the compiled module, so this function just binds them --
+    # nothing is parsed or allocated at runtime. BlowfishEngine makes its own mutable copy.
+
     # Initial contents of key schedule - 18 integers
-    BLOWFISH_P = [
+    BLOWFISH_P = (
         0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344,
         0xa4093822, 0x299f31d0, 0x082efa98, 0xec4e6c89,
         0x452821e6, 0x38d01377, 0xbe5466cf, 0x34e90c6c,
         0xc0ac29b7, 0xc97c50dd, 0x3f84d5b5, 0xb5470917,
         0x9216d5d9, 0x8979fb1b,
-    ]
+    )
 
-    # all 4 blowfish S boxes in one array - 256 integers per S box
-    BLOWFISH_S = [
+    # all 4 blowfish S boxes in one tuple - 256 integers per S box
+    BLOWFISH_S = (
         # sbox 1
-        [
+        (
         0xd1310ba6, 0x98dfb5ac, 0x2ffd72db, 0xd01adfb7,
         0xb8e1afed, 0x6a267e96, 0xba7c9045, 0xf12c7f99,
         0x24a19947, 0xb3916cf7, 0x0801f2e2, 0x858efc16,
@@ -99,9 +103,9 @@ def _init_constants():
         0x08ba6fb5, 0x571be91f, 0xf296ec6b, 0x2a0dd915,
         0xb6636521, 0xe7b9f9b6, 0xff34052e, 0xc5855664,
         0x53b02d5d, 0xa99f8fa1, 0x08ba4799, 0x6e85076a,
-        ],
+        ),
         # sbox 2
-        [
+        (
         0x4b7a70e9, 0xb5b32944, 0xdb75092e, 0xc4192623,
         0xad6ea6b0, 0x49a7df7d, 0x9cee60b8, 0x8fedb266,
         0xecaa8c71, 0x699a17ff, 0x5664526c, 0xc2b19ee1,
@@ -166,9 +170,9 @@ def _init_constants():
         0xdb73dbd3, 0x105588cd, 0x675fda79, 0xe3674340,
         0xc5c43465, 0x713e38d8, 0x3d28f89e, 0xf16dff20,
         0x153e21e7, 0x8fb03d4a, 0xe6e39f2b, 0xdb83adf7,
-        ],
+        ),
         # sbox 3
-        [
+        (
         0xe93d5a68, 0x948140f7, 0xf64c261c, 0x94692934,
         0x411520f7, 0x7602d4f7, 0xbcf46b2e, 0xd4a20068,
         0xd4082471, 0x3320f46a, 0x43b7d4b7, 0x500061af,
@@ -233,9 +237,9 @@ def _init_constants():
         0x1e50ef5e, 0xb161e6f8, 0xa28514d9, 0x6c51133c,
         0x6fd5c7e7, 0x56e14ec4, 0x362abfce, 0xddc6c837,
         0xd79a3234, 0x92638212, 0x670efa8e, 0x406000e0,
-        ],
+        ),
         # sbox 4
-        [
+        (
         0x3a39ce37, 0xd3faf5cf, 0xabc27737, 0x5ac52d1b,
         0x5cb0679e, 0x4fa33742, 0xd3822740, 0x99bc9bbe,
         0xd5118e9d, 0xbf0f7315, 0xd62d1c7e, 0xc700c47b,
@@ -300,8 +304,8 @@ def _init_constants():
         0x1948c25c, 0x02fb8a8c, 0x01c36ae4, 0xd6ebe1f9,
         0x90d4f869, 0xa65cdea0, 0x3f09252d, 0xc208e69f,
         0xb74e6132, 0xce77e25b, 0x578fdfe3, 0x3ac372e6,
-        ]
-    ]
+        ),
+    )
 
 #=============================================================================
 # engine
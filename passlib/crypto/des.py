@@ -76,6 +76,9 @@ _KS_MASK = 0xfcfcfcfcffffffff
 #=============================================================================
 
 # placeholders filled in by _load_tables()
+# NOTE: the tables are nested tuples of literals, which python folds into constants
+#       of the compiled module; so _load_tables() just binds them (and assembles the small PCXROT index),
+#       rather than building them at runtime. they must stay tuples (not lists) for that to hold.
 PCXROT = IE3264 = SPE = CF6464 = None
 
 def _load_tables():
@@ -7,6 +7,7 @@
 #=============================================================================
 from __future__ import division
 # core
+import atexit
 import hashlib
 import logging; log = logging.getLogger(__name__)
 try:
@@ -22,6 +23,7 @@ except ImportError:
 import re
 import os
 from struct import Struct
+import threading
 from warnings import warn
 # site
 try:
@@ -31,9 +33,10 @@ except ImportError:
     _fast_pbkdf2_hmac = None
 # pkg
 from passlib import exc
-from passlib.utils import join_bytes, to_native_str, join_byte_values, to_bytes, \
-                          SequenceMixin
-from passlib.utils.compat import irange, int_types, unicode_or_bytes_types, PY3
+from passlib.utils import join_bytes, to_native_str, join_byte_values, to_bytes, rank_fastest, \
+                          SequenceMixin, cpu_count
+from passlib.utils.compat import irange, int_types, unicode, unicode_or_bytes_types, PY3, \
+    OrderedDict
 from passlib.utils.decor import memoized_property
 # local
 __all__ = [
@@ -41,13 +44,17 @@ __all__ = [
     "lookup_hash",
     "HashInfo",
     "norm_hash_name",
+    "digest_many",
 
     # hmac utils
     "compile_hmac",
+    "clear_hmac_cache",
 
     # kdfs
     "pbkdf1",
     "pbkdf2_hmac",
+    "pbkdf2_hmac_many",
+    "compile_pbkdf",
 ]
 
 #=============================================================================
@@ -451,6 +458,28 @@ class HashInfo(SequenceMixin):
     # eoc
     #=========================================================================
 
+def digest_many(digest, messages):
+    """
+    Calculate the raw digest of each message in a batch.
+
+    :arg digest:
+        digest name or constructor.
+
+    :arg messages:
+        sequence of :class:`!bytes`.
+
+    :returns:
+        list of raw digests, in the same order as *messages*.
+
+    This is used by the :meth:`!verify_many` methods of the salted digest hashes
+    (e.g. :class:`~passlib.hash.ldap_salted_sha1`); the digest is resolved once per batch,
+    and each message goes straight to the constructor, avoiding per-hash overhead.
+
+    .. versionadded:: 1.8
+    """
+    const = lookup_hash(digest).const
+    return [const(msg).digest() for msg in messages]
+
 #=============================================================================
 # hmac utils
 #=============================================================================
@@ -459,7 +488,7 @@ class HashInfo(SequenceMixin):
 _TRANS_5C = join_byte_values((x ^ 0x5C) for x in irange(256))
 _TRANS_36 = join_byte_values((x ^ 0x36) for x in irange(256))
 
-def compile_hmac(digest, key, multipart=False):
+def compile_hmac(digest, key, multipart=False, cache=False):
     """
     This function returns an efficient HMAC function, hardcoded with a specific digest & key.
     It can be used via ``hmac = compile_hmac(digest, key)``.
@@ -473,6 +502,15 @@ def compile_hmac(digest, key, multipart=False):
     :param multipart:
         request a multipart constructor instead (see return description).
 
+    :param cache:
+        if ``True``, the prepared function is stored in a small LRU cache
+        (see :data:`HMAC_CACHE_SIZE`), so repeated calls with the same digest & key
+        skip the key setup. Cache entries are indexed by a keyed fingerprint of *key*,
+        never by the key itself. This should only be used for long-lived keys
+        (e.g. TOTP secrets or application peppers), *not* for user-supplied passwords.
+
+        .. versionadded:: 1.8
+
     :returns:
         By default, the returned function has the signature ``hmac(msg) -> digest output``.
 
@@ -484,20 +522,47 @@ def compile_hmac(digest, key, multipart=False):
         The returned object will also have a ``digest_info`` attribute, containing
         a :class:`lookup_hash` instance for the specified digest.
 
+        Each invocation works on fresh copies of the prepared inner & outer digest states,
+        so the returned object holds no per-message state, and may be shared between threads
+        (which is what allows the *cache* option to hand out the same object repeatedly).
+
     This function exists, and has the weird signature it does, in order to squeeze as
     provide as much efficiency as possible, by omitting much of the setup cost
     and features of the stdlib :mod:`hmac` module.
     """
-    # all the following was adapted from stdlib's hmac module
-
     # resolve digest (cached)
     digest_info = lookup_hash(digest)
-    const, digest_size, block_size = digest_info
-    assert block_size >= 16, "block size too small"
 
     # prepare key
     if not isinstance(key, bytes):
         key = to_bytes(key, param="key")
+
+    if not cache:
+        return _create_hmac(digest_info, key, multipart)
+
+    # check cache
+    ckey = (digest_info.name, multipart, _hmac_key_fingerprint(key))
+    with _hmac_cache_lock:
+        hmac = _hmac_cache.pop(ckey, None)
+        if hmac is not None:
+            _hmac_cache[ckey] = hmac
+            return hmac
+
+    # create & store new entry, evicting least recently used ones
+    hmac = _create_hmac(digest_info, key, multipart)
+    with _hmac_cache_lock:
+        _hmac_cache[ckey] = hmac
+        while len(_hmac_cache) > HMAC_CACHE_SIZE:
+            _hmac_cache.popitem(last=False)
+    return hmac
+
+def _create_hmac(digest_info, key, multipart):
+    """helper for compile_hmac() -- builds hmac function for (already encoded) key"""
+    # all the following was adapted from stdlib's hmac module
+    const, digest_size, block_size = digest_info
+    assert block_size >= 16, "block size too small"
+
+    # prepare key
     klen = len(key)
     if klen > block_size:
         key = const(key).digest()
@@ -536,6 +601,31 @@ def compile_hmac(digest, key, multipart=False):
     hmac.digest_info = digest_info
     return hmac
 
+#: max number of entries kept by ``compile_hmac(cache=True)``
+HMAC_CACHE_SIZE = 128
+
+#: LRU cache used by compile_hmac(), maps (digest name, multipart, key fingerprint) -> hmac
+_hmac_cache = OrderedDict()
+_hmac_cache_lock = threading.Lock()
+
+#: per-process secret used to fingerprint cached keys, so the cache doesn't hold
+#: raw keys, and its index can't be used to test guesses against them.
+_hmac_cache_secret = os.urandom(32)
+
+if hasattr(hashlib, "blake2b"):
+    def _hmac_key_fingerprint(key):
+        return hashlib.blake2b(key, key=_hmac_cache_secret, digest_size=16).digest()
+else: # pragma: no cover -- py2 fallback
+    import hmac as _stdlib_hmac
+
+    def _hmac_key_fingerprint(key):
+        return _stdlib_hmac.new(_hmac_cache_secret, key, hashlib.sha256).digest()
+
+def clear_hmac_cache():
+    """discard all functions cached by ``compile_hmac(cache=True)``"""
+    with _hmac_cache_lock:
+        _hmac_cache.clear()
+
 #=============================================================================
 # pbkdf1 
 #=============================================================================
@@ -569,8 +659,8 @@ def pbkdf1(digest, secret, salt, rounds, keylen=None):
         than the digest size of the specified hash.
     """
     # resolve digest
-    const, digest_size, block_size = lookup_hash(digest)
-    
+    lookup_hash(digest)
+
     # validate secret & salt
     secret = to_bytes(secret, param="secret")
     salt = to_bytes(salt, param="salt")
@@ -581,6 +671,13 @@ def pbkdf1(digest, secret, salt, rounds, keylen=None):
     if rounds < 1:
         raise ValueError("rounds must be at least 1")
 
+    # NOTE: digest & keylen are validated by compile_pbkdf()
+    return compile_pbkdf("pbkdf1", digest, keylen)(secret, salt, rounds)
+
+def _create_pbkdf1_engine(digest_info, keylen):
+    """helper for compile_pbkdf() -- returns pbkdf1 engine"""
+    const, digest_size, _ = digest_info
+
     # validate keylen
     if keylen is None:
         keylen = digest_size
@@ -593,10 +690,17 @@ def pbkdf1(digest, secret, salt, rounds, keylen=None):
                          (keylen, digest_size))
 
     # main pbkdf1 loop
-    block = secret + salt
-    for _ in irange(rounds):
-        block = const(block).digest()
-    return block[:keylen]
+    def engine(secret, salt, rounds):
+        if isinstance(secret, unicode):
+            secret = secret.encode("utf-8")
+        if isinstance(salt, unicode):
+            salt = salt.encode("utf-8")
+        block = const(secret + salt).digest()
+        for _ in irange(rounds - 1):
+            block = const(block).digest()
+        return block if keylen == digest_size else block[:keylen]
+
+    return engine
 
 #=============================================================================
 # pbkdf2
@@ -643,9 +747,46 @@ def pbkdf2_hmac(digest, secret, salt, rounds, keylen=None):
     secret = to_bytes(secret, param="secret")
     salt = to_bytes(salt, param="salt")
 
-    # resolve digest
-    digest_info = lookup_hash(digest)
-    digest_size = digest_info.digest_size
+    # validate rounds
+    if not isinstance(rounds, int_types):
+        raise exc.ExpectedTypeError(rounds, "int", "rounds")
+    if rounds < 1:
+        raise ValueError("rounds must be at least 1")
+
+    # NOTE: digest & keylen are validated by compile_pbkdf()
+    return compile_pbkdf("pbkdf2", digest, keylen)(secret, salt, rounds)
+
+def pbkdf2_hmac_many(digest, pairs, rounds, keylen=None, workers=None):
+    """
+    Calculate :func:`pbkdf2_hmac` for a batch of ``(secret, salt)`` pairs,
+    which share the same digest, rounds, and key length.
+
+    :arg digest:
+        digest name or constructor.
+
+    :arg pairs:
+        sequence of ``(secret, salt)`` tuples;
+        each may be :class:`!bytes` or :class:`unicode` (encoded using UTF-8).
+
+    :param rounds:
+        number of rounds to use to generate each key.
+
+    :arg keylen:
+        number of bytes to generate.
+        if omitted / ``None``, will use digest's native output size.
+
+    :param workers:
+        maximum number of threads to use (defaults to the number of cpus).
+        The batch is only split across threads when the backend releases the GIL
+        (``fastpbkdf2`` and ``hashlib-ssl``); the builtin backend always runs inline.
+
+    :returns:
+        list of raw keys, in the same order as *pairs*.
+
+    .. versionadded:: 1.8
+    """
+    pairs = [(to_bytes(secret, param="secret"), to_bytes(salt, param="salt"))
+             for secret, salt in pairs]
 
     # validate rounds
     if not isinstance(rounds, int_types):
@@ -653,6 +794,53 @@ def pbkdf2_hmac(digest, secret, salt, rounds, keylen=None):
     if rounds < 1:
         raise ValueError("rounds must be at least 1")
 
+    engine = compile_pbkdf("pbkdf2", digest, keylen)
+    if workers is None:
+        workers = cpu_count()
+    workers = min(workers, len(pairs))
+    if workers > 1 and getattr(engine, "releases_gil", False):
+        # split batch into one contiguous chunk per worker, so at most *workers* threads
+        # of the shared pool are used, and results can be rejoined in order.
+        size = -(-len(pairs) // workers)
+        def run_chunk(chunk):
+            return [engine(secret, salt, rounds) for secret, salt in chunk]
+        chunks = _get_thread_pool().map(run_chunk, [pairs[idx:idx+size]
+                                                    for idx in irange(0, len(pairs), size)])
+        return [key for chunk in chunks for key in chunk]
+    return [engine(secret, salt, rounds) for secret, salt in pairs]
+
+#: shared thread pool used by pbkdf2_hmac_many(), as ``(pid, pool)``
+_thread_pool = None
+_thread_pool_lock = threading.Lock()
+
+def _get_thread_pool():
+    """
+    helper for pbkdf2_hmac_many() -- returns module-level thread pool (one thread per cpu),
+    creating it on first use (or after a fork), rather than paying thread startup costs per batch.
+    """
+    global _thread_pool
+    entry = _thread_pool
+    pid = os.getpid()
+    if entry is None or entry[0] != pid:
+        with _thread_pool_lock:
+            entry = _thread_pool
+            if entry is None or entry[0] != pid:
+                from multiprocessing.pool import ThreadPool
+                entry = _thread_pool = (pid, ThreadPool(cpu_count()))
+    return entry[1]
+
+def _close_thread_pool():
+    """shut down shared thread pool at exit (if it was created by this process)"""
+    entry = _thread_pool
+    if entry is not None and entry[0] == os.getpid():
+        entry[1].terminate()
+
+atexit.register(_close_thread_pool)
+
+def _create_pbkdf2_engine(digest_info, keylen):
+    """helper for compile_pbkdf() -- returns pbkdf2 engine"""
+    digest_size = digest_info.digest_size
+
     # validate keylen
     if keylen is None:
         keylen = digest_size
@@ -675,48 +863,148 @@ def pbkdf2_hmac(digest, secret, salt, rounds, keylen=None):
     #
     # check for various high-speed backends
     #
+    name = digest_info.name
 
     # ~3x faster than pure-python backend
     # NOTE: have to do this after above guards since fastpbkdf2 lacks bounds checks.
     if digest_info.supported_by_fastpbkdf2:
-        return _fast_pbkdf2_hmac(digest_info.name, secret, salt, rounds, keylen)
+        fast_pbkdf2_hmac = _fast_pbkdf2_hmac
+        def engine(secret, salt, rounds):
+            if isinstance(secret, unicode):
+                secret = secret.encode("utf-8")
+            if isinstance(salt, unicode):
+                salt = salt.encode("utf-8")
+            return fast_pbkdf2_hmac(name, secret, salt, rounds, keylen)
+        engine.releases_gil = True
+        return engine
 
     # ~1.4x faster than pure-python backend
     # NOTE: have to do this after fastpbkdf2 since hashlib-ssl is slower,
     #       will support larger number of hashes.
     if digest_info.supported_by_hashlib_pbkdf2:
-        return _stdlib_pbkdf2_hmac(digest_info.name, secret, salt, rounds, keylen)
+        stdlib_pbkdf2_hmac = _stdlib_pbkdf2_hmac
+        def engine(secret, salt, rounds):
+            if isinstance(secret, unicode):
+                secret = secret.encode("utf-8")
+            if isinstance(salt, unicode):
+                salt = salt.encode("utf-8")
+            return stdlib_pbkdf2_hmac(name, secret, salt, rounds, keylen)
+        engine.releases_gil = True
+        return engine
 
     #
     # otherwise use our own implementation
     #
 
-    # generated keyed hmac
-    keyed_hmac = compile_hmac(digest, secret)
-
     # get helper to calculate pbkdf2 inner loop efficiently
     calc_block = _get_pbkdf2_looper(digest_size)
 
-    # assemble & return result
-    return join_bytes(
-        calc_block(keyed_hmac, keyed_hmac(salt + _pack_uint32(i)), rounds)
-        for i in irange(1, block_count + 1)
-    )[:keylen]
+    # precalculate block suffixes
+    block_suffixes = [_pack_uint32(i) for i in irange(1, block_count + 1)]
+
+    def engine(secret, salt, rounds):
+        if isinstance(salt, unicode):
+            salt = salt.encode("utf-8")
+
+        # generated keyed hmac (encodes unicode secret using utf-8)
+        keyed_hmac = compile_hmac(digest_info, secret)
+
+        # assemble & return result
+        if block_count == 1:
+            return calc_block(keyed_hmac, keyed_hmac(salt + block_suffixes[0]), rounds)[:keylen]
+        return join_bytes(
+            calc_block(keyed_hmac, keyed_hmac(salt + suffix), rounds)
+            for suffix in block_suffixes
+        )[:keylen]
+
+    return engine
+
+#=============================================================================
+# shared kdf engine
+#=============================================================================
+
+#: max number of engines kept by compile_pbkdf()
+PBKDF_ENGINE_CACHE_SIZE = 64
+
+#: LRU cache of engines returned by compile_pbkdf(), keyed by (kdf, digest, keylen)
+_pbkdf_engine_cache = OrderedDict()
+_pbkdf_engine_cache_lock = threading.Lock()
+
+#: map of kdf name -> helper which creates engine
+_pbkdf_engine_factories = dict(
+    pbkdf1=_create_pbkdf1_engine,
+    pbkdf2=_create_pbkdf2_engine,
+)
+
+def compile_pbkdf(kdf, digest, keylen=None):
+    """
+    Returns an efficient function implementing pbkdf1 or pbkdf2-hmac,
+    hardcoded with a specific digest & key length.
+    It can be used via ``engine = compile_pbkdf("pbkdf2", "sha512", 64)``.
+
+    :arg kdf:
+        either ``"pbkdf1"`` or ``"pbkdf2"``.
+
+    :arg digest:
+        digest name or constructor.
+
+    :arg keylen:
+        number of bytes to generate (if omitted / ``None``, uses digest's native size).
+
+    :returns:
+        function with the signature ``engine(secret, salt, rounds) -> bytes``.
+        The first backend supported by the digest (see :func:`pbkdf2_hmac`) is selected up front,
+        so each call goes straight to it.
+
+    Unlike :func:`pbkdf1` and :func:`pbkdf2_hmac`, the returned function performs minimal validation:
+    *secret* & *salt* must be :class:`!bytes` (or another buffer accepted by the backend),
+    or :class:`!unicode` (encoded using UTF-8); and *rounds* must be a positive integer.
+    It's intended for hash handlers, which have already validated their settings.
+    Engines are kept in a small LRU cache (see :data:`PBKDF_ENGINE_CACHE_SIZE`),
+    so repeated calls with the same arguments are cheap.
+    pbkdf2 engines whose backend releases the GIL have a ``releases_gil = True`` attribute.
+
+    .. versionadded:: 1.8
+    """
+    key = (kdf, digest, keylen)
+    try:
+        with _pbkdf_engine_cache_lock:
+            engine = _pbkdf_engine_cache.pop(key, None)
+            if engine is not None:
+                _pbkdf_engine_cache[key] = engine
+                return engine
+    except TypeError:
+        # NOTE: TypeError is to catch 'TypeError: unhashable type' (e.g. HashInfo)
+        key = None
+    try:
+        factory = _pbkdf_engine_factories[kdf]
+    except KeyError:
+        raise ValueError("unknown kdf: %r" % (kdf,))
+    engine = factory(lookup_hash(digest), keylen)
+    if key is None:
+        return engine
+    with _pbkdf_engine_cache_lock:
+        # NOTE: setdefault() so threads which race to build an engine all return the same one
+        engine = _pbkdf_engine_cache.setdefault(key, engine)
+        while len(_pbkdf_engine_cache) > PBKDF_ENGINE_CACHE_SIZE:
+            _pbkdf_engine_cache.popitem(last=False)
+    return engine
 
 #-------------------------------------------------------------------------------------
 # pick best choice for pure-python helper
 # TODO: consider some alternatives, such as C-accelerated xor_bytes helper if available
 #-------------------------------------------------------------------------------------
-# NOTE: this env var is only present to support the admin/benchmark_pbkdf2 script
-_force_backend = os.environ.get("PASSLIB_PBKDF2_BACKEND") or "any"
+#: map of builtin pbkdf2 loop implementations -> function which returns loop helper for a digest size,
+#: in order of preference.  see _get_pbkdf2_looper() for the helper's signature.
+_pbkdf2_looper_factories = OrderedDict()
 
-if PY3 and _force_backend in ["any", "from-bytes"]:
+if PY3:
     from functools import partial
 
-    def _get_pbkdf2_looper(digest_size):
-        return partial(_pbkdf2_looper, digest_size)
+    def _get_from_bytes_looper(digest_size):
+        return partial(_from_bytes_looper, digest_size)
 
-    def _pbkdf2_looper(digest_size, keyed_hmac, digest, rounds):
+    def _from_bytes_looper(digest_size, keyed_hmac, digest, rounds):
         """
         py3-only implementation of pbkdf2 inner loop;
         uses 'int.from_bytes' + integer XOR
@@ -729,142 +1017,163 @@ if PY3 and _force_backend in ["any", "from-bytes"]:
             accum ^= from_bytes(digest, BIG)
         return accum.to_bytes(digest_size, BIG)
 
-    _builtin_backend = "from-bytes"
+    _pbkdf2_looper_factories["from-bytes"] = _get_from_bytes_looper
 
-elif _force_backend in ["any", "unpack", "from-bytes"]:
-    from struct import Struct
-    from passlib.utils import sys_bits
+from passlib.utils import sys_bits
 
-    _have_64_bit = (sys_bits >= 64)
+_have_64_bit = (sys_bits >= 64)
 
-    #: cache used by _get_pbkdf2_looper
-    _looper_cache = {}
+#: cache used by _get_unpack_looper
+_looper_cache = {}
 
-    def _get_pbkdf2_looper(digest_size):
-        """
-        We want a helper function which performs equivalent of the following::
-
-          def helper(keyed_hmac, digest, rounds):
-              accum = digest
-              for _ in irange(rounds - 1):
-                  digest = keyed_hmac(digest)
-                  accum ^= digest
-              return accum
-
-        However, no efficient way to implement "bytes ^ bytes" in python.
-        Instead, using approach where we dynamically compile a helper function based
-        on digest size.  Instead of a single `accum` var, this helper breaks the digest
-        into a series of integers.
-
-        It stores these in a series of`accum_<i>` vars, and performs `accum ^= digest`
-        by unpacking digest and perform xor for each "accum_<i> ^= digest_<i>".
-        this keeps everything in locals, avoiding excessive list creation, encoding or decoding,
-        etc.
-
-        :param digest_size:
-            digest size to compile for, in bytes. (must be multiple of 4).
-
-        :return:
-            helper function with call signature outlined above.
-        """
-        #
-        # cache helpers
-        #
-        try:
-            return _looper_cache[digest_size]
-        except KeyError:
-            pass
+def _get_unpack_looper(digest_size):
+    """
+    We want a helper function which performs equivalent of the following::
+
+      def helper(keyed_hmac, digest, rounds):
+          accum = digest
+          for _ in irange(rounds - 1):
+              digest = keyed_hmac(digest)
+              accum ^= digest
+          return accum
+
+    However, no efficient way to implement "bytes ^ bytes" in python.
+    Instead, using approach where we dynamically compile a helper function based
+    on digest size.  Instead of a single `accum` var, this helper breaks the digest
+    into a series of integers.
+
+    It stores these in a series of`accum_<i>` vars, and performs `accum ^= digest`
+    by unpacking digest and perform xor for each "accum_<i> ^= digest_<i>".
+    this keeps everything in locals, avoiding excessive list creation, encoding or decoding,
+    etc.
+
+    :param digest_size:
+        digest size to compile for, in bytes. (must be multiple of 4).
+
+    :return:
+        helper function with call signature outlined above.
+    """
+    #
+    # cache helpers
+    #
+    try:
+        return _looper_cache[digest_size]
+    except KeyError:
+        pass
 
-        #
-        # figure out most efficient struct format to unpack digest into list of native ints
-        #
-        if _have_64_bit and not digest_size & 0x7:
-            # digest size multiple of 8, on a 64 bit system -- use array of UINT64
+    #
+    # figure out most efficient struct format to unpack digest into list of native ints
+    #
+    if _have_64_bit and not digest_size & 0x7:
+        # digest size multiple of 8, on a 64 bit system -- use array of UINT64
+        count = (digest_size >> 3)
+        fmt = "=%dQ" % count
+    elif not digest_size & 0x3:
+        if _have_64_bit:
+            # digest size multiple of 4, on a 64 bit system -- use array of UINT64 + 1 UINT32
             count = (digest_size >> 3)
-            fmt = "=%dQ" % count
-        elif not digest_size & 0x3:
-            if _have_64_bit:
-                # digest size multiple of 4, on a 64 bit system -- use array of UINT64 + 1 UINT32
-                count = (digest_size >> 3)
-                fmt = "=%dQI" % count
-                count += 1
-            else:
-                # digest size multiple of 4, on a 32 bit system -- use array of UINT32
-                count = (digest_size >> 2)
-                fmt = "=%dI" % count
+            fmt = "=%dQI" % count
+            count += 1
         else:
-            # stopping here, cause no known hashes have digest size that isn't multiple of 4 bytes.
-            # if needed, could go crazy w/ "H" & "B"
-            raise NotImplementedError("unsupported digest size: %d" % digest_size)
-        struct = Struct(fmt)
-
-        #
-        # build helper source
-        #
-        tdict = dict(
-            digest_size=digest_size,
-            accum_vars=", ".join("acc_%d" % i for i in irange(count)),
-            digest_vars=", ".join("dig_%d" % i for i in irange(count)),
-        )
-
-        # head of function
-        source = (
-                        "def helper(keyed_hmac, digest, rounds):\n"
-                        "    '''pbkdf2 loop helper for digest_size={digest_size}'''\n"
-                        "    unpack_digest = struct.unpack\n"
-                        "    {accum_vars} = unpack_digest(digest)\n"
-                        "    for _ in irange(1, rounds):\n"
-                        "        digest = keyed_hmac(digest)\n"
-                        "        {digest_vars} = unpack_digest(digest)\n"
-        ).format(**tdict)
-
-        # xor digest
-        for i in irange(count):
-            source +=   "        acc_%d ^= dig_%d\n" % (i, i)
-
-        # return result
-        source +=       "    return struct.pack({accum_vars})\n".format(**tdict)
-
-        #
-        # compile helper
-        #
-        code = compile(source, "<generated by passlib.crypto.digest._get_pbkdf2_looper()>", "exec")
-        gdict = dict(irange=irange, struct=struct)
-        ldict = dict()
-        eval(code, gdict, ldict)
-        helper = ldict['helper']
-        if __debug__:
-            helper.__source__ = source
-
-        #
-        # store in cache
-        #
-        _looper_cache[digest_size] = helper
-        return helper
-
-    _builtin_backend = "unpack"
+            # digest size multiple of 4, on a 32 bit system -- use array of UINT32
+            count = (digest_size >> 2)
+            fmt = "=%dI" % count
+    else:
+        # stopping here, cause no known hashes have digest size that isn't multiple of 4 bytes.
+        # if needed, could go crazy w/ "H" & "B"
+        raise NotImplementedError("unsupported digest size: %d" % digest_size)
+    struct = Struct(fmt)
 
-else:
-    assert _force_backend in ["any", "hexlify"]
+    #
+    # build helper source
+    #
+    tdict = dict(
+        digest_size=digest_size,
+        accum_vars=", ".join("acc_%d" % i for i in irange(count)),
+        digest_vars=", ".join("dig_%d" % i for i in irange(count)),
+    )
+
+    # head of function
+    source = (
+                    "def helper(keyed_hmac, digest, rounds):\n"
+                    "    '''pbkdf2 loop helper for digest_size={digest_size}'''\n"
+                    "    unpack_digest = struct.unpack\n"
+                    "    {accum_vars} = unpack_digest(digest)\n"
+                    "    for _ in irange(1, rounds):\n"
+                    "        digest = keyed_hmac(digest)\n"
+                    "        {digest_vars} = unpack_digest(digest)\n"
+    ).format(**tdict)
+
+    # xor digest
+    for i in irange(count):
+        source +=   "        acc_%d ^= dig_%d\n" % (i, i)
+
+    # return result
+    source +=       "    return struct.pack({accum_vars})\n".format(**tdict)
 
-    # XXX: older & slower approach that used int(hexlify()),
-    #      keeping it around for a little while just for benchmarking.
+    #
+    # compile helper
+    #
+    code = compile(source, "<generated by passlib.crypto.digest._get_unpack_looper()>", "exec")
+    gdict = dict(irange=irange, struct=struct)
+    ldict = dict()
+    eval(code, gdict, ldict)
+    helper = ldict['helper']
+    if __debug__:
+        helper.__source__ = source
 
-    from binascii import hexlify as _hexlify
-    from passlib.utils import int_to_bytes
+    #
+    # store in cache
+    #
+    return _looper_cache.setdefault(digest_size, helper)
 
-    def _get_pbkdf2_looper(digest_size):
-        return _pbkdf2_looper
+_pbkdf2_looper_factories["unpack"] = _get_unpack_looper
 
-    def _pbkdf2_looper(keyed_hmac, digest, rounds):
-        hexlify = _hexlify
-        accum = int(hexlify(digest), 16)
-        for _ in irange(rounds - 1):
-            digest = keyed_hmac(digest)
-            accum ^= int(hexlify(digest), 16)
-        return int_to_bytes(accum, len(digest))
+# XXX: older & slower approach that used int(hexlify()),
+#      keeping it around for a little while just for benchmarking.
+
+from binascii import hexlify as _hexlify
+from passlib.utils import int_to_bytes
+
+def _get_hexlify_looper(digest_size):
+    return _hexlify_looper
+
+def _hexlify_looper(keyed_hmac, digest, rounds):
+    hexlify = _hexlify
+    accum = int(hexlify(digest), 16)
+    for _ in irange(rounds - 1):
+        digest = keyed_hmac(digest)
+        accum ^= int(hexlify(digest), 16)
+    return int_to_bytes(accum, len(digest))
+
+_pbkdf2_looper_factories["hexlify"] = _get_hexlify_looper
+
+def _prepare_looper_benchmark(name):
+    """helper for rank_fastest() -- runs looper against fixed input"""
+    looper = _pbkdf2_looper_factories[name](32)
+    keyed_hmac = compile_hmac("sha256", b"passlib looper benchmark")
+    digest = keyed_hmac(b"salt")
+    return lambda: looper(keyed_hmac, digest, 1000)
+
+# NOTE: this env var is only present to support the admin/benchmark_pbkdf2 script,
+#       and to allow picking the fastest loop via PASSLIB_PBKDF2_BACKEND=fastest.
+_force_backend = os.environ.get("PASSLIB_PBKDF2_BACKEND") or "any"
+
+if _force_backend == "from-bytes" and not PY3:
+    _force_backend = "unpack"
+
+if _force_backend == "fastest":
+    _builtin_backend = rank_fastest("pbkdf2-looper", list(_pbkdf2_looper_factories),
+                                    _prepare_looper_benchmark)[0]
+elif _force_backend in _pbkdf2_looper_factories:
+    _builtin_backend = _force_backend
+else:
+    assert _force_backend == "any", "unknown PASSLIB_PBKDF2_BACKEND: %r" % (_force_backend,)
+    _builtin_backend = next(iter(_pbkdf2_looper_factories))
 
-    _builtin_backend = "hexlify"
+#: function used to get pbkdf2 loop helper for a given digest size,
+#: helper has signature ``helper(keyed_hmac, digest, rounds) -> accumulated digest``.
+_get_pbkdf2_looper = _pbkdf2_looper_factories[_builtin_backend]
 
 # helper for benchmark script -- disable hashlib, fastpbkdf2 support if builtin requested
 if _force_backend == _builtin_backend:
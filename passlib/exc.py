@@ -252,6 +252,19 @@ def type_name(value):
     else:
         return cls.__name__
 
+def _rebuild_error(name, message):
+    """
+    recreate exception (with message only) from its class name --
+    used to re-raise errors which occurred in another interpreter or process.
+    looks up passlib & builtin exception classes, falling back to RuntimeError.
+    """
+    from passlib.utils.compat import builtins
+    cls = globals().get(name) or getattr(builtins, name, None)
+    if not (isinstance(cls, type) and issubclass(cls, Exception)):
+        return RuntimeError("%s: %s" % (name, message))
+    # NOTE: bypassing __init__, since some of the classes above have custom signatures
+    return cls.__new__(cls, message)
+
 def ExpectedTypeError(value, expected, param):
     """error message when param was supposed to be one type, but found another"""
     # NOTE: value is never displayed, since it may sometimes be a password.
@@ -0,0 +1,97 @@
+"""passlib.ext.django.management.commands.passlib_upgrade_candidates
+
+management command which scans the user table, and reports which
+password hashes will be upgraded by the current ``PASSLIB_CONFIG``.
+"""
+#=============================================================================
+# imports
+#=============================================================================
+# core
+from __future__ import absolute_import, division, print_function
+import logging; log = logging.getLogger(__name__)
+# site
+from django.contrib.auth import get_user_model
+from django.core.management.base import BaseCommand
+# pkg
+from passlib.utils.compat import OrderedDict, iteritems
+# local
+__all__ = ["Command"]
+
+#=============================================================================
+# command
+#=============================================================================
+class Command(BaseCommand):
+    help = ("Scan the user table for password hashes that will be upgraded on next login "
+            "(via CryptContext.needs_update()), and report counts per scheme.")
+
+    def add_arguments(self, parser):
+        parser.add_argument("-o", "--output",
+                            help="write primary keys of upgrade candidates to this file, one per line")
+        parser.add_argument("--chunk-size", type=int, default=2000,
+                            help="number of users to fetch from the database at once")
+
+    def handle(self, output=None, chunk_size=2000, **options):
+        from passlib.ext.django.models import adapter
+        context = adapter.context
+        is_password_usable = adapter.is_password_usable
+        manager = get_user_model()._default_manager.order_by("pk")
+
+        # only need to load full user objects if categories are in use
+        if adapter._ignore_user_category is context._config:
+            rows = (row + (None,) for row in
+                    self._iter_chunked(manager.values_list("pk", "password"), chunk_size,
+                                       lambda row: row[0]))
+        else:
+            get_user_category = adapter.get_user_category
+            rows = ((user.pk, user.password, get_user_category(user)) for user in
+                    self._iter_chunked(manager.all(), chunk_size,
+                                       lambda user: user.pk))
+
+        # maps scheme -> [total, candidates]
+        stats = OrderedDict()
+        outfile = open(output, "w") if output else None
+        try:
+            for pk, hash, category in rows:
+                if not hash or not is_password_usable(hash):
+                    scheme = "<unusable>"
+                    candidate = False
+                else:
+                    scheme = context.identify(hash, category=category) or "<unknown>"
+                    candidate = (scheme != "<unknown>" and
+                                 context.needs_update(hash, category=category))
+                counts = stats.setdefault(scheme, [0, 0])
+                counts[0] += 1
+                if candidate:
+                    counts[1] += 1
+                    if outfile:
+                        outfile.write("%s\n" % (pk,))
+        finally:
+            if outfile:
+                outfile.close()
+
+        # report
+        write = self.stdout.write
+        write("%-30s %10s %10s" % ("scheme", "users", "upgrades"))
+        total = [0, 0]
+        for scheme, (count, candidates) in iteritems(stats):
+            write("%-30s %10d %10d" % (scheme, count, candidates))
+            total[0] += count
+            total[1] += candidates
+        write("%-30s %10d %10d" % ("total", total[0], total[1]))
+
+    @staticmethod
+    def _iter_chunked(queryset, size, get_pk):
+        """iterate over pk-ordered queryset in chunks, to keep memory use bounded"""
+        last = None
+        while True:
+            chunk = queryset if last is None else queryset.filter(pk__gt=last)
+            chunk = list(chunk[:size])
+            if not chunk:
+                return
+            for row in chunk:
+                yield row
+            last = get_pk(chunk[-1])
+
+#=============================================================================
+# eof
+#=============================================================================
@@ -6,6 +6,7 @@
 from functools import update_wrapper, wraps
 import logging; log = logging.getLogger(__name__)
 import sys
+import threading
 import weakref
 from warnings import warn
 # site
@@ -19,6 +20,7 @@ except ImportError:
 from passlib import exc, registry
 from passlib.context import CryptContext
 from passlib.exc import PasslibRuntimeWarning
+from passlib.utils import timer
 from passlib.utils.compat import get_method_function, iteritems, OrderedDict, unicode
 from passlib.utils.decor import memoized_property
 # local
@@ -159,6 +161,13 @@ class DjangoTranslator(object):
     #: value stores weakrefs to passlib hasher.
     _passlib_hasher_cache = None
 
+    #: precomputed translation tables for all of the context's hashers,
+    #: built by build_hasher_tables(), and wiped by reset_hashers().
+    #: stored as a ``(config, to_django, django_by_name, passlib_by_name)`` tuple,
+    #: mapping passlib hasher / name -> django hasher, django name -> django hasher,
+    #: and django name -> passlib hasher. only valid while ``context._config is config``.
+    _hasher_tables = None
+
     #=============================================================================
     # init
     #=============================================================================
@@ -175,6 +184,52 @@ class DjangoTranslator(object):
         self._django_hasher_cache.clear()
         self._passlib_hasher_cache.clear()
         self._django_unsalted_sha1 = None
+        self._hasher_tables = None
+
+    def build_hasher_tables(self):
+        """
+        precompute translations for all hashers in the context,
+        so that lookups only cost a single dict access.
+        tables remain valid until :meth:`reset_hashers` is called.
+        """
+        context = self.context
+        if context is None:
+            return
+        django_hasher_table = {}
+        django_name_table = {}
+        passlib_name_table = {}
+        for handler in context.schemes(resolve=True):
+            try:
+                hasher = self.passlib_to_django(handler, cached=False)
+            except ValueError:
+                # leave unresolvable hashers to the uncached lookup code,
+                # so errors are raised when (and if) they're actually used.
+                continue
+            django_hasher_table[handler] = django_hasher_table[handler.name] = hasher
+            django_name_table.setdefault(hasher.algorithm, hasher)
+            passlib_name_table.setdefault(hasher.algorithm, handler)
+
+        # resolve default
+        handler = context.handler() if django_hasher_table else None
+        if handler in django_hasher_table:
+            django_name_table["default"] = django_hasher_table[handler]
+            passlib_name_table["default"] = handler
+
+        # special case: django's separate "unsalted_sha1" hasher (see resolve_django_hasher)
+        handler = passlib_name_table.get("sha1")
+        if handler is not None and handler.name == "django_salted_sha1":
+            django_name_table["unsalted_sha1"] = self._create_django_hasher("unsalted_sha1")
+            passlib_name_table["unsalted_sha1"] = handler
+
+        self._hasher_tables = (context._config, django_hasher_table,
+                               django_name_table, passlib_name_table)
+
+    def _get_hasher_table(self, index):
+        """return precomputed table, or None if not built / out of date"""
+        tables = self._hasher_tables
+        if tables is not None and tables[0] is self.context._config:
+            return tables[index]
+        return None
 
     def _get_passlib_hasher(self, passlib_name):
         """
@@ -209,6 +264,15 @@ class DjangoTranslator(object):
         :returns:
             django hasher instance
         """
+        # check precomputed table
+        if cached:
+            table = self._get_hasher_table(1)
+            if table is not None:
+                try:
+                    return table[passlib_hasher]
+                except KeyError:
+                    pass
+
         # resolve names to hasher
         if not hasattr(passlib_hasher, "name"):
             passlib_hasher = self._get_passlib_hasher(passlib_hasher)
@@ -289,6 +353,15 @@ class DjangoTranslator(object):
         :returns:
             passlib hasher or name
         """
+        # check precomputed table
+        if cached:
+            table = self._get_hasher_table(3)
+            if table is not None:
+                try:
+                    return table[django_name]
+                except (KeyError, TypeError):
+                    pass
+
         # check for django hasher
         if hasattr(django_name, "algorithm"):
 
@@ -363,6 +436,15 @@ class DjangoTranslator(object):
         """
         Take in a django algorithm name, return django hasher.
         """
+        # check precomputed table
+        if cached:
+            table = self._get_hasher_table(2)
+            if table is not None:
+                try:
+                    return table[django_name]
+                except (KeyError, TypeError):
+                    pass
+
         # check for django hasher
         if hasattr(django_name, "algorithm"):
             return django_name
@@ -428,6 +510,13 @@ class DjangoContextAdapter(DjangoTranslator):
     #: patch status
     patched = False
 
+    #: DeferredUpgrades instance (if enabled via PASSLIB_DEFERRED_UPGRADES setting)
+    deferred_upgrades = None
+
+    #: set by build_hasher_tables() to the context config if it has no user categories,
+    #: allowing get_user_category() call to be skipped.
+    _ignore_user_category = None
+
     #=============================================================================
     # init
     #=============================================================================
@@ -474,6 +563,17 @@ class DjangoContextAdapter(DjangoTranslator):
 
         # reset internal caches
         super(DjangoContextAdapter, self).reset_hashers()
+        self._ignore_user_category = None
+
+        # rebuild translation tables (only safe once patch is installed,
+        # otherwise hasher lookups would recurse through django's get_hashers())
+        if self.patched:
+            self.build_hasher_tables()
+
+    def build_hasher_tables(self):
+        super(DjangoContextAdapter, self).build_hasher_tables()
+        config = self.context._config
+        self._ignore_user_category = None if config.categories else config
 
     #=============================================================================
     # django hashers helpers -- hasher lookup
@@ -587,13 +687,24 @@ class DjangoContextAdapter(DjangoTranslator):
         hash = user.password
         if not self.is_password_usable(hash):
             return False
-        cat = self.get_user_category(user)
+        if self._ignore_user_category is self.context._config:
+            cat = None
+        else:
+            cat = self.get_user_category(user)
         ok, new_hash = self.context.verify_and_update(password, hash,
                                                       category=cat)
         if ok and new_hash is not None:
             # migrate to new hash if needed.
-            user.password = new_hash
-            user.save()
+            upgrades = self.deferred_upgrades
+            if upgrades is None:
+                user.password = new_hash
+                user.save()
+            else:
+                # NOTE: leaving user.password as the hash that's still in the
+                #       database, since django's login() derives the session
+                #       auth hash from it; if it changed before the upgrade
+                #       was flushed, get_user() would reject the session.
+                upgrades.add(user, hash, new_hash)
         return ok
 
     def user_set_password(self, user, password):
@@ -603,7 +714,10 @@ class DjangoContextAdapter(DjangoTranslator):
         if password is None:
             user.set_unusable_password()
         else:
-            cat = self.get_user_category(user)
+            if self._ignore_user_category is self.context._config:
+                cat = None
+            else:
+                cat = self.get_user_category(user)
             user.password = self.context.hash(password, category=cat)
 
     def get_user_category(self, user):
@@ -698,6 +812,9 @@ class DjangoContextAdapter(DjangoTranslator):
         # done!
         self.patched = True
         log.debug("... finished monkeypatching django")
+
+        # now that lookups won't recurse, precompute hasher translations
+        self.build_hasher_tables()
         return True
 
     def remove_patch(self):
@@ -715,6 +832,8 @@ class DjangoContextAdapter(DjangoTranslator):
         log = self.log
         manager = self._manager
 
+        self._set_deferred_upgrades(None)
+
         if self.patched:
             log.debug("removing django monkeypatching...")
             manager.unpatch_all(unpatch_conflicts=True)
@@ -803,14 +922,218 @@ class DjangoContextAdapter(DjangoTranslator):
         else:
             self.__dict__.pop("get_category", None)
 
+        # setup deferred upgrades
+        upgrades = getattr(settings, "PASSLIB_DEFERRED_UPGRADES", None)
+        if upgrades:
+            if upgrades is True:
+                upgrades = {}
+            elif not isinstance(upgrades, dict):
+                raise exc.ExpectedTypeError(upgrades, "bool or dict", "PASSLIB_DEFERRED_UPGRADES")
+            upgrades = DeferredUpgrades(**upgrades)
+        else:
+            upgrades = None
+        self._set_deferred_upgrades(upgrades)
+
         # setup context
         self.context.load(config)
         self.reset_hashers()
 
+    def _set_deferred_upgrades(self, upgrades):
+        """replace DeferredUpgrades instance, flushing the old one"""
+        old = self.deferred_upgrades
+        if old is not None:
+            old.stop()
+        if upgrades is not None:
+            upgrades.start()
+            self.deferred_upgrades = upgrades
+        else:
+            self.__dict__.pop("deferred_upgrades", None)
+
     #=============================================================================
     # eof
     #=============================================================================
 
+#=============================================================================
+# deferred password upgrades
+#=============================================================================
+class DeferredUpgrades(object):
+    """
+    Collects hashes upgraded by :meth:`DjangoContextAdapter.user_check_password`,
+    and writes them to the database in batches, instead of issuing
+    an ``UPDATE`` for every login which needed its hash upgraded.
+
+    Enabled via the ``PASSLIB_DEFERRED_UPGRADES`` django setting.
+
+    :param batch_size:
+        maximum number of hashes written per ``UPDATE`` statement;
+        also triggers an early flush once this many are pending.
+
+    :param max_delay:
+        maximum number of seconds a pending upgrade will wait before being flushed.
+
+    :param background:
+        if ``True``, pending upgrades are flushed by a background thread.
+        otherwise they're flushed at the end of a request (via django's
+        ``request_finished`` signal) once *batch_size* or *max_delay* is reached.
+
+    Each row is only updated if its password hasn't changed since it was
+    verified, so a password change made in the meantime won't be overwritten.
+    Upgrades which are lost (e.g. due to a crash before flushing) are harmless,
+    they'll just be retried the next time the user logs in.
+    """
+    #=============================================================================
+    # instance attrs
+    #=============================================================================
+
+    #: pending upgrades, maps ``(model, pk) -> (old_hash, new_hash)``
+    _pending = None
+
+    #: timestamp oldest pending upgrade was added
+    _first = None
+
+    #: background thread & its wakeup event
+    _thread = None
+    _wakeup = None
+
+    #: set by stop()
+    _stopped = False
+
+    #=============================================================================
+    # init
+    #=============================================================================
+    def __init__(self, batch_size=100, max_delay=5.0, background=False):
+        if batch_size < 1:
+            raise ValueError("batch_size must be >= 1")
+        if max_delay <= 0:
+            raise ValueError("max_delay must be > 0")
+        self.batch_size = batch_size
+        self.max_delay = max_delay
+        self.background = background
+        self._lock = threading.Lock()
+        self._pending = OrderedDict()
+
+    def start(self):
+        """connect to request_finished signal, or start background thread"""
+        self._stopped = False
+        if self.background:
+            self._wakeup = threading.Event()
+            thread = self._thread = threading.Thread(target=self._run,
+                                                     name="passlib-django-upgrades")
+            thread.daemon = True
+            thread.start()
+        else:
+            from django.core.signals import request_finished
+            request_finished.connect(self._request_finished, weak=False,
+                                     dispatch_uid=id(self))
+
+    def stop(self):
+        """disconnect from signal / stop background thread, and flush pending upgrades"""
+        self._stopped = True
+        if self.background:
+            thread = self._thread
+            if thread is not None:
+                self._wakeup.set()
+                thread.join()
+                self._thread = None
+        else:
+            from django.core.signals import request_finished
+            request_finished.disconnect(dispatch_uid=id(self))
+        self.flush()
+
+    #=============================================================================
+    # queue management
+    #=============================================================================
+    @property
+    def pending(self):
+        """number of upgrades waiting to be written"""
+        return len(self._pending)
+
+    def add(self, user, old_hash, new_hash):
+        """queue upgrade of user's hash from *old_hash* to *new_hash*"""
+        key = (type(user), user.pk)
+        with self._lock:
+            prev = self._pending.get(key)
+            if prev is not None:
+                # keep hash that's actually in the database
+                old_hash = prev[0]
+            self._pending[key] = (old_hash, new_hash)
+            if self._first is None:
+                self._first = timer()
+            full = len(self._pending) >= self.batch_size
+        if full and self.background:
+            self._wakeup.set()
+
+    def _is_due(self):
+        first = self._first
+        return first is not None and (len(self._pending) >= self.batch_size or
+                                      timer() - first >= self.max_delay)
+
+    def flush(self):
+        """write all pending upgrades to the database, returns number of rows updated"""
+        with self._lock:
+            pending = self._pending
+            if not pending:
+                return 0
+            self._pending = OrderedDict()
+            self._first = None
+        groups = OrderedDict()
+        for (model, pk), (old_hash, new_hash) in iteritems(pending):
+            groups.setdefault(model, []).append((pk, old_hash, new_hash))
+        count = 0
+        size = self.batch_size
+        for model, rows in iteritems(groups):
+            for idx in range(0, len(rows), size):
+                try:
+                    count += self._update_rows(model, rows[idx:idx+size])
+                except Exception:
+                    log.error("failed to write %d upgraded password hashes for %r",
+                              len(rows[idx:idx+size]), model, exc_info=True)
+        return count
+
+    @staticmethod
+    def _update_rows(model, rows):
+        """
+        update password of all *rows* via a single UPDATE statement
+        (similar to ``bulk_update()``, but conditional on the old hash still being present).
+        returns number of rows actually updated.
+        """
+        from django.db.models import Case, F, Q, Value, When
+        # NOTE: old hash is checked in the WHERE clause (not just the CASE),
+        #       so rows whose password changed since being verified are left alone entirely,
+        #       and aren't included in the returned count.
+        where = Q()
+        whens = []
+        for pk, old_hash, new_hash in rows:
+            match = Q(pk=pk, password=old_hash)
+            where |= match
+            whens.append(When(match, then=Value(new_hash)))
+        return model._default_manager.filter(where).update(
+            password=Case(*whens, default=F("password")))
+
+    #=============================================================================
+    # flush triggers
+    #=============================================================================
+    def _request_finished(self, **kwds):
+        if self._is_due():
+            self.flush()
+
+    def _run(self):
+        """background thread main loop"""
+        from django.db import connections
+        wakeup = self._wakeup
+        while not self._stopped:
+            wakeup.wait(self.max_delay)
+            wakeup.clear()
+            if self._pending:
+                self.flush()
+                # don't hold db connections open between flushes
+                for conn in connections.all():
+                    conn.close()
+
+    #=============================================================================
+    # eoc
+    #=============================================================================
+
 #=============================================================================
 # wrapping passlib handlers as django hashers
 #=============================================================================
@@ -574,7 +574,7 @@ class _CffiBackend(_Argon2Common):
     @classmethod
     def hash(cls, secret):
         # TODO: add in 'encoding' support once that's finalized in 1.8 / 1.9.
-        uh.validate_secret(secret)
+        secret = uh.validate_secret(secret)
         secret = to_bytes(secret, "utf-8")
         # XXX: doesn't seem to be a way to make this honor max_threads
         try:
@@ -593,7 +593,7 @@ class _CffiBackend(_Argon2Common):
     @classmethod
     def verify(cls, secret, hash):
         # TODO: add in 'encoding' support once that's finalized in 1.8 / 1.9.
-        uh.validate_secret(secret)
+        secret = uh.validate_secret(secret)
         secret = to_bytes(secret, "utf-8")
         hash = to_bytes(hash, "ascii")
         if hash.startswith(b"$argon2d$"):
@@ -614,7 +614,7 @@ class _CffiBackend(_Argon2Common):
     @classmethod
     def genhash(cls, secret, config):
         # TODO: add in 'encoding' support once that's finalized in 1.8 / 1.9.
-        uh.validate_secret(secret)
+        secret = uh.validate_secret(secret)
         secret = to_bytes(secret, "utf-8")
         self = cls.from_string(config)
         if self.type_d:
@@ -700,7 +700,7 @@ class _PureBackend(_Argon2Common):
     #===================================================================
     def _calc_checksum(self, secret):
         # TODO: add in 'encoding' support once that's finalized in 1.8 / 1.9.
-        uh.validate_secret(secret)
+        secret = uh.validate_secret(secret)
         secret = to_bytes(secret, "utf-8")
         if self.type_d:
             type = _argon2pure.ARGON2D
@@ -456,7 +456,7 @@ class _BcryptCommon(uh.SubclassBackendMixin, uh.TruncateMixin, uh.HasManyIdents,
             secret = secret.encode("utf-8")
 
         # check max secret size
-        uh.validate_secret(secret)
+        secret = uh.validate_secret(secret)
 
         # check for truncation (during .hash() calls only)
         if new:
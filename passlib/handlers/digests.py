@@ -41,10 +41,11 @@ class HexDigestHash(uh.StaticHandler):
     def _norm_hash(cls, hash):
         return hash.lower()
 
-    def _calc_checksum(self, secret):
+    @classmethod
+    def _calc_static_checksum(cls, secret):
         if isinstance(secret, unicode):
             secret = secret.encode("utf-8")
-        return str_to_uascii(self._hash_func(secret).hexdigest())
+        return str_to_uascii(cls._hash_func(secret).hexdigest())
 
     #===================================================================
     # eoc
@@ -95,7 +96,7 @@ class htdigest(uh.MinimalHandler):
         # unchanged, the encoding kwd is only used to handle unicode values.
         if not encoding:
             encoding = cls.default_encoding
-        uh.validate_secret(secret)
+        secret = uh.validate_secret(secret)
         if isinstance(secret, unicode):
             secret = secret.encode(encoding)
         user = to_bytes(user, encoding, "user")
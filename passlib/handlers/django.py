@@ -4,7 +4,7 @@
 #=============================================================================
 # core
 from base64 import b64encode
-from binascii import hexlify
+from binascii import hexlify, unhexlify
 from hashlib import md5, sha1, sha256
 import logging; log = logging.getLogger(__name__)
 # site
@@ -71,6 +71,28 @@ class DjangoSaltedHash(uh.HasSalt, uh.GenericHandler):
     def to_string(self):
         return uh.render_mc2(self.ident, self.salt, self.checksum)
 
+    @classmethod
+    def _parse_salted_digest(cls, hash):
+        # NOTE: used by verify_many() for subclasses which set _salted_digest;
+        #       assumes checksum is the lowercase hexdigest of ``salt + secret``.
+        salt, chk = uh.parse_mc2(hash, cls.ident, handler=cls)
+        if chk is None:
+            raise uh.exc.MissingDigestError(cls)
+        if len(chk) != cls.checksum_size or chk != chk.lower():
+            cls.from_string(hash) # should throw error
+        try:
+            raw = unhexlify(chk.encode("ascii"))
+        except (TypeError, ValueError):
+            cls.from_string(hash) # should throw error
+            raise
+        return cls._norm_salt(salt), raw
+
+    @classmethod
+    def _salted_digest_message(cls, secret, salt):
+        if isinstance(secret, unicode):
+            secret = secret.encode("utf-8")
+        return salt.encode("ascii") + secret
+
 # NOTE: only used by PBKDF2
 class DjangoVariableHash(uh.HasRounds, DjangoSaltedHash):
     """base class providing common code for django hashes w/ variable rounds"""
@@ -117,6 +139,7 @@ class django_salted_sha1(DjangoSaltedHash):
     django_name = "sha1"
     ident = u"sha1$"
     checksum_size = 40
+    _salted_digest = "sha1"
 
     def _calc_checksum(self, secret):
         if isinstance(secret, unicode):
@@ -155,6 +178,7 @@ class django_salted_md5(DjangoSaltedHash):
     django_name = "md5"
     ident = u"md5$"
     checksum_size = 32
+    _salted_digest = "md5"
 
     def _calc_checksum(self, secret):
         if isinstance(secret, unicode):
@@ -496,7 +520,7 @@ class django_disabled(uh.ifc.DisabledHash, uh.StaticHandler):
 
     @classmethod
     def verify(cls, secret, hash):
-        uh.validate_secret(secret)
+        secret = uh.validate_secret(secret)
         if not cls.identify(hash):
             raise uh.exc.InvalidHashError(cls)
         return False
@@ -13,7 +13,8 @@ import logging; log = logging.getLogger(__name__)
 from passlib.utils import to_unicode
 import passlib.utils.handlers as uh
 from passlib.utils.compat import bascii_to_str, iteritems, u, unicode
-from passlib.crypto.digest import pbkdf1
+from passlib.utils.decor import memoized_class_property
+from passlib.crypto.digest import compile_pbkdf
 # local
 __all__ = [
     'fshp',
@@ -95,6 +96,12 @@ class fshp(uh.HasRounds, uh.HasRawSalt, uh.HasRawChecksum, uh.GenericHandler):
         [(v[0],k) for k,v in iteritems(_variant_info)]
         )
 
+    @memoized_class_property
+    def _pbkdf1_engines(cls):
+        """map of variant -> pbkdf1 engine, compiled on first use"""
+        return dict((variant, compile_pbkdf("pbkdf1", name, size))
+                    for variant, (name, size) in iteritems(cls._variant_info))
+
     #===================================================================
     # configuration
     #===================================================================
@@ -196,13 +203,7 @@ class fshp(uh.HasRounds, uh.HasRawSalt, uh.HasRawChecksum, uh.GenericHandler):
         # NOTE: for some reason, FSHP uses pbkdf1 with password & salt reversed.
         #       this has only a minimal impact on security,
         #       but it is worth noting this deviation.
-        return pbkdf1(
-            digest=self.checksum_alg,
-            secret=self.salt,
-            salt=secret,
-            rounds=self.rounds,
-            keylen=self.checksum_size,
-            )
+        return self._pbkdf1_engines[self.variant](self.salt, secret, self.rounds)
 
     #===================================================================
     # eoc
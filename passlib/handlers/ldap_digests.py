@@ -50,10 +50,11 @@ class _Base64DigestHelper(uh.StaticHandler):
         """tell StaticHandler to strip ident from checksum"""
         return cls.ident
 
-    def _calc_checksum(self, secret):
+    @classmethod
+    def _calc_static_checksum(cls, secret):
         if isinstance(secret, unicode):
             secret = secret.encode("utf-8")
-        chk = self._hash_func(secret).digest()
+        chk = cls._hash_func(secret).digest()
         return b64encode(chk).decode("ascii")
 
 class _SaltedBase64DigestHelper(uh.HasRawSalt, uh.HasRawChecksum, uh.GenericHandler):
@@ -87,6 +88,26 @@ class _SaltedBase64DigestHelper(uh.HasRawSalt, uh.HasRawChecksum, uh.GenericHand
         assert cs
         return cls(checksum=data[:cs], salt=data[cs:])
 
+    @classmethod
+    def _parse_salted_digest(cls, hash):
+        # NOTE: mirrors from_string(), used by verify_many()
+        hash = to_unicode(hash, "ascii", "hash")
+        m = cls._hash_regex.match(hash)
+        if not m:
+            raise uh.exc.InvalidHashError(cls)
+        try:
+            data = b64decode(m.group("tmp").encode("ascii"))
+        except TypeError:
+            raise uh.exc.MalformedHashError(cls)
+        cs = cls.checksum_size
+        return cls._norm_salt(data[cs:]), data[:cs]
+
+    @classmethod
+    def _salted_digest_message(cls, secret, salt):
+        if isinstance(secret, unicode):
+            secret = secret.encode("utf-8")
+        return secret + salt
+
     def to_string(self):
         data = self.checksum + self.salt
         hash = self.ident + b64encode(data).decode("ascii")
@@ -157,6 +178,7 @@ class ldap_salted_md5(_SaltedBase64DigestHelper):
     ident = u"{SMD5}"
     checksum_size = 16
     _hash_func = md5
+    _salted_digest = "md5"
     _hash_regex = re.compile(u(r"^\{SMD5\}(?P<tmp>[+/a-zA-Z0-9]{27,}={0,2})$"))
 
 class ldap_salted_sha1(_SaltedBase64DigestHelper):
@@ -196,6 +218,7 @@ class ldap_salted_sha1(_SaltedBase64DigestHelper):
     ident = u"{SSHA}"
     checksum_size = 20
     _hash_func = sha1
+    _salted_digest = "sha1"
     _hash_regex = re.compile(u(r"^\{SSHA\}(?P<tmp>[+/a-zA-Z0-9]{32,}={0,2})$"))
 
 class ldap_plaintext(plaintext):
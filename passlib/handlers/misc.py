@@ -183,7 +183,7 @@ class plaintext(uh.MinimalHandler):
 
     @classmethod
     def hash(cls, secret, encoding=None):
-        uh.validate_secret(secret)
+        secret = uh.validate_secret(secret)
         if not encoding:
             encoding = cls.default_encoding
         return to_native_str(secret, encoding, "secret")
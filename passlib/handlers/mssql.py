@@ -163,7 +163,7 @@ class mssql2000(uh.HasRawSalt, uh.HasRawChecksum, uh.GenericHandler):
     def verify(cls, secret, hash):
         # NOTE: we only compare against the upper-case hash
         # XXX: add 'full' just to verify both checksums?
-        uh.validate_secret(secret)
+        secret = uh.validate_secret(secret)
         self = cls.from_string(hash)
         chk = self.checksum
         if chk is None:
@@ -235,6 +235,22 @@ class mssql2005(uh.HasRawSalt, uh.HasRawChecksum, uh.GenericHandler):
             secret = secret.decode("utf-8")
         return _raw_mssql(secret, self.salt)
 
+    #===================================================================
+    # batch verify helpers (see GenericHandler._salted_digest)
+    #===================================================================
+    _salted_digest = "sha1"
+
+    @classmethod
+    def _parse_salted_digest(cls, hash):
+        data = _parse_mssql(hash, 54, 26, cls)
+        return data[:4], data[4:]
+
+    @classmethod
+    def _salted_digest_message(cls, secret, salt):
+        if isinstance(secret, bytes):
+            secret = secret.decode("utf-8")
+        return secret.encode("utf-16-le") + salt
+
     #===================================================================
     # eoc
     #===================================================================
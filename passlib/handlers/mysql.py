@@ -63,7 +63,8 @@ class mysql323(uh.StaticHandler):
     def _norm_hash(cls, hash):
         return hash.lower()
 
-    def _calc_checksum(self, secret):
+    @classmethod
+    def _calc_static_checksum(cls, secret):
         # FIXME: no idea if mysql has a policy about handling unicode passwords
         if isinstance(secret, unicode):
             secret = secret.encode("utf-8")
@@ -113,7 +114,8 @@ class mysql41(uh.StaticHandler):
     def _norm_hash(cls, hash):
         return hash.upper()
 
-    def _calc_checksum(self, secret):
+    @classmethod
+    def _calc_static_checksum(cls, secret):
         # FIXME: no idea if mysql has a policy about handling unicode passwords
         if isinstance(secret, unicode):
             secret = secret.encode("utf-8")
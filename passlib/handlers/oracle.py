@@ -163,6 +163,30 @@ class oracle11(uh.HasSalt, uh.GenericHandler):
         chk = sha1(secret + unhexlify(self.salt.encode("ascii"))).hexdigest()
         return str_to_uascii(chk).upper()
 
+    #===================================================================
+    # batch verify helpers (see GenericHandler._salted_digest)
+    #===================================================================
+    _salted_digest = "sha1"
+
+    @classmethod
+    def _parse_salted_digest(cls, hash):
+        # NOTE: mirrors from_string(), used by verify_many()
+        hash = to_unicode(hash, "ascii", "hash")
+        m = cls._hash_regex.match(hash)
+        if not m:
+            raise uh.exc.InvalidHashError(cls)
+        salt, chk = m.group("salt", "chk")
+        # NOTE: from_string() passes salt through HasSalt validation (which rejects lowercase),
+        #       so doing the same here, to keep verify_many() consistent with verify().
+        salt = cls._norm_salt(salt)
+        return unhexlify(salt.encode("ascii")), unhexlify(chk.encode("ascii"))
+
+    @classmethod
+    def _salted_digest_message(cls, secret, salt):
+        if isinstance(secret, unicode):
+            secret = secret.encode("utf-8")
+        return secret + salt
+
     #===================================================================
     # eoc
     #===================================================================
@@ -8,10 +8,11 @@ from base64 import b64encode, b64decode
 import logging; log = logging.getLogger(__name__)
 # site
 # pkg
-from passlib.utils import to_unicode
+from passlib.utils import consteq, to_unicode
 from passlib.utils.binary import ab64_decode, ab64_encode
 from passlib.utils.compat import str_to_bascii, uascii_to_str, unicode
-from passlib.crypto.digest import pbkdf2_hmac
+from passlib.crypto.digest import compile_pbkdf, pbkdf2_hmac_many
+from passlib.utils.decor import memoized_class_property
 import passlib.utils.handlers as uh
 # local
 __all__ = [
@@ -26,6 +27,12 @@ __all__ = [
 #=============================================================================
 #
 #=============================================================================
+def _pbkdf2_engine_property(digest, keylen):
+    """create class property holding pbkdf2 engine (compiled on first use)"""
+    def _pbkdf2_engine(cls):
+        return staticmethod(compile_pbkdf("pbkdf2", digest, keylen))
+    return memoized_class_property(_pbkdf2_engine)
+
 class Pbkdf2DigestHandler(uh.HasRounds, uh.HasRawSalt, uh.HasRawChecksum, uh.GenericHandler):
     """base class for various pbkdf2_{digest} algorithms"""
     #===================================================================
@@ -49,6 +56,11 @@ class Pbkdf2DigestHandler(uh.HasRounds, uh.HasRawSalt, uh.HasRawChecksum, uh.Gen
     #--this class--
     _digest = None # name of subclass-specified hash
 
+    @memoized_class_property
+    def _pbkdf2_engine(cls):
+        """pbkdf2 engine for this class's digest, compiled on first use"""
+        return staticmethod(compile_pbkdf("pbkdf2", cls._digest, cls.checksum_size))
+
     # NOTE: max_salt_size and max_rounds are arbitrarily chosen to provide sanity check.
     #       the underlying pbkdf2 specifies no bounds for either.
 
@@ -74,8 +86,31 @@ class Pbkdf2DigestHandler(uh.HasRounds, uh.HasRawSalt, uh.HasRawChecksum, uh.Gen
         return uh.render_mc3(self.ident, self.rounds, salt, chk)
 
     def _calc_checksum(self, secret):
-        # NOTE: pbkdf2_hmac() will encode secret & salt using UTF8
-        return pbkdf2_hmac(self._digest, secret, self.salt, self.rounds, self.checksum_size)
+        # NOTE: pbkdf2 engine will encode secret & salt using UTF8
+        return self._pbkdf2_engine(secret, self.salt, self.rounds)
+
+    @classmethod
+    def verify_many(cls, pairs, **context):
+        if context:
+            return super(Pbkdf2DigestHandler, cls).verify_many(pairs, **context)
+        # parse everything up front, then hand each group of hashes
+        # sharing a rounds value to pbkdf2_hmac_many() as a single batch.
+        records = []
+        groups = {}
+        for idx, (secret, hash) in enumerate(pairs):
+            secret = uh.validate_secret(secret)
+            self = cls.from_string(hash)
+            if self.checksum is None:
+                raise uh.exc.MissingDigestError(cls)
+            records.append(self.checksum)
+            groups.setdefault(self.rounds, []).append((idx, secret, self.salt))
+        result = [False] * len(records)
+        for rounds, group in groups.items():
+            raws = pbkdf2_hmac_many(cls._digest, [(secret, salt) for _, secret, salt in group],
+                                    rounds, cls.checksum_size)
+            for (idx, _, _), raw in zip(group, raws):
+                result[idx] = consteq(raw, records[idx])
+        return result
 
 def create_pbkdf2_hash(hash_name, digest_size, rounds=12000, ident=None, module=__name__):
     """create new Pbkdf2DigestHandler subclass for a specific hash"""
@@ -200,6 +235,9 @@ class cta_pbkdf2_sha1(uh.HasRounds, uh.HasRawSalt, uh.HasRawChecksum, uh.Generic
     max_rounds = 0xffffffff # setting at 32-bit limit for now
     rounds_cost = "linear"
 
+    #--this class--
+    _pbkdf2_engine = _pbkdf2_engine_property("sha1", 20)
+
     #===================================================================
     # formatting
     #===================================================================
@@ -229,8 +267,8 @@ class cta_pbkdf2_sha1(uh.HasRounds, uh.HasRawSalt, uh.HasRawChecksum, uh.Generic
     # backend
     #===================================================================
     def _calc_checksum(self, secret):
-        # NOTE: pbkdf2_hmac() will encode secret & salt using utf-8
-        return pbkdf2_hmac("sha1", secret, self.salt, self.rounds, 20)
+        # NOTE: pbkdf2 engine will encode secret & salt using utf-8
+        return self._pbkdf2_engine(secret, self.salt, self.rounds)
 
     #===================================================================
     # eoc
@@ -299,6 +337,9 @@ class dlitz_pbkdf2_sha1(uh.HasRounds, uh.HasSalt, uh.GenericHandler):
     max_rounds = 0xffffffff # setting at 32-bit limit for now
     rounds_cost = "linear"
 
+    #--this class--
+    _pbkdf2_engine = _pbkdf2_engine_property("sha1", 24)
+
     #===================================================================
     # formatting
     #===================================================================
@@ -332,9 +373,9 @@ class dlitz_pbkdf2_sha1(uh.HasRounds, uh.HasSalt, uh.GenericHandler):
     # backend
     #===================================================================
     def _calc_checksum(self, secret):
-        # NOTE: pbkdf2_hmac() will encode secret & salt using utf-8
+        # NOTE: pbkdf2 engine will encode secret & salt using utf-8
         salt = self._get_config()
-        result = pbkdf2_hmac("sha1", secret, salt, self.rounds, 24)
+        result = self._pbkdf2_engine(secret, salt, self.rounds)
         return ab64_encode(result).decode("ascii")
 
     #===================================================================
@@ -376,6 +417,9 @@ class atlassian_pbkdf2_sha1(uh.HasRawSalt, uh.HasRawChecksum, uh.GenericHandler)
     #--HasRawSalt--
     min_salt_size = max_salt_size = 16
 
+    #--this class--
+    _pbkdf2_engine = _pbkdf2_engine_property("sha1", 32)
+
     @classmethod
     def from_string(cls, hash):
         hash = to_unicode(hash, "ascii", "hash")
@@ -394,8 +438,8 @@ class atlassian_pbkdf2_sha1(uh.HasRawSalt, uh.HasRawChecksum, uh.GenericHandler)
     def _calc_checksum(self, secret):
         # TODO: find out what crowd's policy is re: unicode
         # crowd seems to use a fixed number of rounds.
-        # NOTE: pbkdf2_hmac() will encode secret & salt using utf-8
-        return pbkdf2_hmac("sha1", secret, self.salt, 10000, 32)
+        # NOTE: pbkdf2 engine will encode secret & salt using utf-8
+        return self._pbkdf2_engine(secret, self.salt, 10000)
 
 #=============================================================================
 # grub
@@ -451,6 +495,8 @@ class grub_pbkdf2_sha512(uh.HasRounds, uh.HasRawSalt, uh.HasRawChecksum, uh.Gene
     max_rounds = 0xffffffff # setting at 32-bit limit for now
     rounds_cost = "linear"
 
+    _pbkdf2_engine = _pbkdf2_engine_property("sha512", 64)
+
     @classmethod
     def from_string(cls, hash):
         rounds, salt, chk = uh.parse_mc3(hash, cls.ident, sep=u".",
@@ -467,8 +513,8 @@ class grub_pbkdf2_sha512(uh.HasRounds, uh.HasRawSalt, uh.HasRawChecksum, uh.Gene
 
     def _calc_checksum(self, secret):
         # TODO: find out what grub's policy is re: unicode
-        # NOTE: pbkdf2_hmac() will encode secret & salt using utf-8
-        return pbkdf2_hmac("sha512", secret, self.salt, self.rounds, 64)
+        # NOTE: pbkdf2 engine will encode secret & salt using utf-8
+        return self._pbkdf2_engine(secret, self.salt, self.rounds)
 
 #=============================================================================
 # eof
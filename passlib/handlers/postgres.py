@@ -40,10 +40,11 @@ class postgres_md5(uh.HasUserContext, uh.StaticHandler):
     #===================================================================
     # primary interface
     #===================================================================
-    def _calc_checksum(self, secret):
+    @classmethod
+    def _calc_static_checksum(cls, secret, user=None):
         if isinstance(secret, unicode):
             secret = secret.encode("utf-8")
-        user = to_bytes(self.user, "utf-8", param="user")
+        user = to_bytes(user, "utf-8", param="user")
         return str_to_uascii(md5(secret + user).hexdigest())
 
     #===================================================================
@@ -3,17 +3,23 @@
 # imports
 #=============================================================================
 # core
+from binascii import a2b_base64, b2a_base64, Error as _BinAsciiError
+from collections import OrderedDict
 import logging; log = logging.getLogger(__name__)
+import os
+import threading
 # site
 # pkg
-from passlib.utils import consteq, saslprep, to_native_str, splitcomma
+from passlib.utils import consteq, saslprep, to_native_str, splitcomma, xor_bytes
 from passlib.utils.binary import ab64_decode, ab64_encode
 from passlib.utils.compat import bascii_to_str, iteritems, native_string_types
-from passlib.crypto.digest import pbkdf2_hmac, norm_hash_name
+from passlib.crypto.digest import compile_hmac, lookup_hash, pbkdf2_hmac, norm_hash_name
 import passlib.utils.handlers as uh
 # local
 __all__ = [
     "scram",
+    "ScramServer",
+    "ScramExchange",
 ]
 
 #=============================================================================
@@ -71,7 +77,10 @@ class scram(uh.HasRounds, uh.HasRawSalt, uh.HasRawChecksum, uh.GenericHandler):
 
     .. automethod:: extract_digest_info
     .. automethod:: extract_digest_algs
+    .. automethod:: extract_server_keys
     .. automethod:: derive_digest
+
+    See :class:`ScramServer` for a complete server-side SCRAM exchange built on these.
     """
     #===================================================================
     # class attrs
@@ -185,6 +194,36 @@ class scram(uh.HasRounds, uh.HasRawSalt, uh.HasRawChecksum, uh.GenericHandler):
         else:
             return [norm_hash_name(alg, format) for alg in algs]
 
+    @classmethod
+    def extract_server_keys(cls, hash, alg):
+        """return (salt, rounds, stored_key, server_key) for specific hash algorithm.
+
+        This derives the ``StoredKey`` and ``ServerKey`` values a SCRAM server needs
+        from the ``SaltedPassword`` digest stored in the hash::
+
+            ClientKey := HMAC(SaltedPassword, "Client Key")
+            StoredKey := H(ClientKey)
+            ServerKey := HMAC(SaltedPassword, "Server Key")
+
+        This only takes a few digest calls (it doesn't run PBKDF2).
+
+        :arg hash: :class:`!scram` hash stored for desired user
+        :arg alg: name of digest algorithm, as accepted by :meth:`extract_digest_info`.
+
+        :raises KeyError:
+            If the hash does not contain an entry for the requested digest algorithm.
+
+        :returns:
+            A tuple containing ``(salt, rounds, stored_key, server_key)``,
+            the last three of which are raw bytes.
+
+        .. versionadded:: 1.8
+        """
+        salt, rounds, digest = cls.extract_digest_info(hash, alg)
+        hmac = compile_hmac(norm_hash_name(alg, "hashlib"), digest)
+        stored_key = hmac.digest_info.const(hmac(b"Client Key")).digest()
+        return salt, rounds, stored_key, hmac(b"Server Key")
+
     @classmethod
     def derive_digest(cls, password, salt, rounds, alg):
         """helper to create SaltedPassword digest for SCRAM.
@@ -208,11 +247,15 @@ class scram(uh.HasRounds, uh.HasRawSalt, uh.HasRawChecksum, uh.GenericHandler):
         :returns:
             raw bytes of ``SaltedPassword``
         """
+        # NOTE: pbkdf2_hmac() will handle normalizing alg name.
+        return pbkdf2_hmac(alg, cls._prepare_secret(password), salt, rounds)
+
+    @staticmethod
+    def _prepare_secret(password):
+        """helper to perform the ``Normalize(password)`` step, returning utf-8 bytes"""
         if isinstance(password, bytes):
             password = password.decode("utf-8")
-        # NOTE: pbkdf2_hmac() will encode secret & salt using utf-8,
-        #       and handle normalizing alg name.
-        return pbkdf2_hmac(alg, saslprep(password), salt, rounds)
+        return saslprep(password).encode("utf-8")
 
     #===================================================================
     # serialization
@@ -363,27 +406,32 @@ class scram(uh.HasRounds, uh.HasRawSalt, uh.HasRawChecksum, uh.GenericHandler):
     # digest methods
     #===================================================================
     def _calc_checksum(self, secret, alg=None):
+        return self._calc_prepared_checksum(self._prepare_secret(secret), alg)
+
+    def _calc_prepared_checksum(self, secret, alg=None):
+        """same as _calc_checksum(), but takes secret already returned by _prepare_secret()"""
+        # NOTE: secret is only normalized & encoded once, and reused for each alg.
         rounds = self.rounds
         salt = self.salt
-        hash = self.derive_digest
         if alg:
             # if requested, generate digest for specific alg
-            return hash(secret, salt, rounds, alg)
+            return pbkdf2_hmac(alg, secret, salt, rounds)
         else:
             # by default, return dict containing digests for all algs
             return dict(
-                (alg, hash(secret, salt, rounds, alg))
+                (alg, pbkdf2_hmac(alg, secret, salt, rounds))
                 for alg in self.algs
             )
 
     @classmethod
     def verify(cls, secret, hash, full=False):
-        uh.validate_secret(secret)
+        secret = uh.validate_secret(secret)
         self = cls.from_string(hash)
         chkmap = self.checksum
         if not chkmap:
             raise ValueError("expected %s hash, got %s config string instead" %
                              (cls.name, cls.name))
+        secret = self._prepare_secret(secret)
 
         # NOTE: to make the verify method efficient, we just calculate hash
         # of shortest digest by default. apps can pass in "full=True" to
@@ -391,7 +439,7 @@ class scram(uh.HasRounds, uh.HasRawSalt, uh.HasRawChecksum, uh.GenericHandler):
         if full:
             correct = failed = False
             for alg, digest in iteritems(chkmap):
-                other = self._calc_checksum(secret, alg)
+                other = self._calc_prepared_checksum(secret, alg)
                 # NOTE: could do this length check in norm_algs(),
                 # but don't need to be that strict, and want to be able
                 # to parse hashes containing algs not supported by platform.
@@ -413,7 +461,7 @@ class scram(uh.HasRounds, uh.HasRawSalt, uh.HasRawChecksum, uh.GenericHandler):
             # otherwise only verify against one hash, pick one w/ best security.
             for alg in self._verify_algs:
                 if alg in chkmap:
-                    other = self._calc_checksum(secret, alg)
+                    other = self._calc_prepared_checksum(secret, alg)
                     return consteq(other, chkmap[alg])
             # there should always be sha-1 at the very least,
             # or something went wrong inside _norm_algs()
@@ -423,6 +471,319 @@ class scram(uh.HasRounds, uh.HasRawSalt, uh.HasRawChecksum, uh.GenericHandler):
     #
     #===================================================================
 
+#=============================================================================
+# scram server exchange
+#=============================================================================
+def _b64encode(data):
+    """encode bytes using standard base64 (as used by SCRAM messages)"""
+    return bascii_to_str(b2a_base64(data).rstrip())
+
+def _b64decode(value):
+    """decode standard base64 from SCRAM message"""
+    try:
+        return a2b_base64(value.encode("ascii"))
+    except (_BinAsciiError, UnicodeEncodeError):
+        raise ValueError("invalid base64 in SCRAM message")
+
+def _parse_attrs(message, names):
+    """split SCRAM message into list of values for the expected attribute *names*"""
+    parts = message.split(",")
+    if len(parts) < len(names):
+        raise ValueError("malformed SCRAM message")
+    values = []
+    for name, part in zip(names, parts):
+        if part[:2] != name + "=":
+            raise ValueError("malformed SCRAM message: expected %r attribute" % (name,))
+        values.append(part[2:])
+    return values
+
+def _decode_saslname(value):
+    """decode username / authzid from SCRAM message (``=2C`` and ``=3D`` escapes)"""
+    if "=" in value.replace("=2C", "").replace("=3D", ""):
+        raise ValueError("malformed SCRAM message: invalid username encoding")
+    return value.replace("=2C", ",").replace("=3D", "=")
+
+class ScramServer(object):
+    """Server side of the SCRAM authentication exchange (:rfc:`5802`),
+    using credentials stored as :class:`~passlib.hash.scram` hashes.
+
+    Each authentication runs entirely off the ``StoredKey`` and ``ServerKey``
+    values derived from the stored digest (see :meth:`scram.extract_server_keys`), so it costs
+    a few HMAC calls rather than a PBKDF2 derivation.  The derived keys (with their HMAC
+    key setup already done) are kept in a small LRU cache, keyed by the stored hash, so
+    repeat logins by the same user skip parsing the hash as well; changing a user's
+    password changes their hash, so stale entries are never used.
+
+    :arg lookup:
+        callable which takes the username sent by the client
+        (as unicode, with escapes decoded and normalized using :func:`~passlib.utils.saslprep`),
+        and returns that user's :class:`!scram` hash, or ``None`` if there is no such user.
+
+    :param cache_size:
+        maximum number of users to keep derived keys for (defaults to 1024; 0 disables caching).
+
+    :param policy:
+        optional :class:`!scram` handler (e.g. ``scram.using(rounds=...)``) whose
+        ``default_rounds`` & ``default_salt_size`` are used for the fake records sent to unknown users.
+        If omitted, fake records copy the rounds & salt size most common among
+        the stored hashes seen so far (falling back to :class:`!scram`'s defaults),
+        so they look the same as those of existing users.
+
+    Usage::
+
+        >>> server = ScramServer(lambda username: users.get(username))
+        >>> exchange = server.exchange("SCRAM-SHA-256")
+        >>> server_first = exchange.process_client_first(client_first)
+        >>> server_final = exchange.process_client_final(client_final)
+        >>> exchange.authenticated
+        True
+
+    Channel binding (the ``-PLUS`` mechanisms) isn't supported.
+
+    .. automethod:: exchange
+    .. automethod:: clear_cache
+
+    .. versionadded:: 1.8
+    """
+    #: default size of server nonces, in bytes (before base64 encoding)
+    nonce_size = 18
+
+    def __init__(self, lookup, cache_size=1024, policy=None):
+        self.lookup = lookup
+        self.cache_size = cache_size
+        self.policy = policy
+        self._cache = OrderedDict()
+        self._cache_lock = threading.Lock()
+        # counts of ``(salt size, rounds)`` among stored hashes, used to shape fake records
+        self._shapes = {}
+        # key used to generate consistent fake salts for unknown users
+        self._fake_salt_key = os.urandom(32)
+
+    def exchange(self, alg):
+        """
+        Start a new authentication exchange.
+
+        :arg alg:
+            digest algorithm the client selected; can be a SCRAM mechanism name
+            (e.g. ``"SCRAM-SHA-256"``), or any name accepted by
+            :func:`~passlib.crypto.digest.norm_hash_name`.
+
+        :returns: a new :class:`ScramExchange` instance.
+        """
+        return ScramExchange(self, norm_hash_name(alg, "iana"))
+
+    def clear_cache(self):
+        """discard all cached keys"""
+        with self._cache_lock:
+            self._cache.clear()
+
+    def _get_keys(self, hash, alg):
+        """
+        return ``(salt, rounds, stored_key, client_hmac, server_hmac)`` for hash & alg,
+        where ``client_hmac`` & ``server_hmac`` are HMAC functions keyed by StoredKey & ServerKey.
+        """
+        ckey = (hash, alg)
+        with self._cache_lock:
+            entry = self._cache.pop(ckey, None)
+            if entry is not None:
+                self._cache[ckey] = entry
+                return entry
+        salt, rounds, stored_key, server_key = scram.extract_server_keys(hash, alg)
+        digest = norm_hash_name(alg, "hashlib")
+        entry = (salt, rounds, stored_key,
+                 compile_hmac(digest, stored_key), compile_hmac(digest, server_key))
+        shape = (len(salt), rounds)
+        with self._cache_lock:
+            self._shapes[shape] = self._shapes.get(shape, 0) + 1
+        if self.cache_size > 0:
+            with self._cache_lock:
+                self._cache[ckey] = entry
+                while len(self._cache) > self.cache_size:
+                    self._cache.popitem(last=False)
+        return entry
+
+    def _get_fake_shape(self):
+        """return ``(salt size, rounds)`` to use for fake records"""
+        policy = self.policy
+        if policy is not None:
+            return policy.default_salt_size, policy.default_rounds
+        with self._cache_lock:
+            shapes = self._shapes
+            if shapes:
+                return max(shapes, key=shapes.get)
+        return scram.default_salt_size, scram.default_rounds
+
+    def _get_fake_keys(self, username, alg, hash=None):
+        """
+        return keys for unknown user, so the exchange proceeds as normal (and then fails),
+        rather than revealing whether the user exists.  salt is consistent per username,
+        and salt size & rounds match those of existing users (see :meth:`_get_fake_shape`).
+        if *hash* is provided (user exists, but lacks digest for *alg*),
+        its real salt & rounds are used instead.
+        """
+        salt = None
+        if hash is not None:
+            try:
+                record = scram.from_string(hash)
+            except ValueError:
+                pass
+            else:
+                salt, rounds = record.salt, record.rounds
+        if salt is None:
+            salt_size, rounds = self._get_fake_shape()
+            key = compile_hmac("sha512", self._fake_salt_key)
+            salt = b""
+            counter = 0
+            while len(salt) < salt_size:
+                salt += key(username.encode("utf-8") + b"\x00" + str(counter).encode("ascii"))
+                counter += 1
+            salt = salt[:salt_size]
+        digest = norm_hash_name(alg, "hashlib")
+        size = lookup_hash(digest).digest_size
+        return (salt, rounds, os.urandom(size),
+                compile_hmac(digest, os.urandom(size)), compile_hmac(digest, os.urandom(size)))
+
+class ScramExchange(object):
+    """A single server-side SCRAM exchange, created by :meth:`ScramServer.exchange`.
+
+    .. automethod:: process_client_first
+    .. automethod:: process_client_final
+
+    .. attribute:: username
+
+        username sent by client (set by :meth:`process_client_first`).
+
+    .. attribute:: authzid
+
+        authorization identity sent by client, or ``None``.
+
+    .. attribute:: authenticated
+
+        ``True`` once :meth:`process_client_final` has verified the client's proof.
+
+    .. versionadded:: 1.8
+    """
+    username = None
+    authzid = None
+    authenticated = False
+
+    def __init__(self, server, alg):
+        self.server = server
+        self.alg = alg
+        self._state = "client-first"
+
+    def process_client_first(self, message, nonce=None):
+        """
+        Process the client's first message, and return the server's first message.
+
+        :arg message: client-first-message, as unicode or utf-8 bytes.
+
+        :param nonce:
+            server nonce to use (mainly for testing); by default a random one is generated.
+
+        :raises ValueError: if the message is malformed, or requests channel binding.
+
+        :returns: server-first-message (as unicode).
+        """
+        if self._state != "client-first":
+            raise RuntimeError("process_client_first() already called")
+        if isinstance(message, bytes):
+            message = message.decode("utf-8")
+
+        # parse gs2 header -- "{n,y,p=...},[a=authzid],"
+        parts = message.split(",", 2)
+        if len(parts) != 3:
+            raise ValueError("malformed SCRAM client-first message")
+        cbind_flag, authzid, bare = parts
+        if cbind_flag not in ("n", "y"):
+            raise ValueError("SCRAM channel binding not supported")
+        if authzid:
+            if not authzid.startswith("a="):
+                raise ValueError("malformed SCRAM client-first message")
+            self.authzid = _decode_saslname(authzid[2:])
+
+        # parse client-first-message-bare -- "[m=...,]n=username,r=nonce[,extensions]"
+        if bare.startswith("m="):
+            raise ValueError("unsupported SCRAM extension")
+        username, client_nonce = _parse_attrs(bare, ("n", "r"))
+        if not client_nonce:
+            raise ValueError("malformed SCRAM client-first message: empty nonce")
+        # NOTE: per rfc 5802 sec 5.1, username is unescaped, then prepared using saslprep,
+        #       so it matches however the client chose to normalize it.
+        try:
+            username = saslprep(_decode_saslname(username), param="username")
+        except ValueError as err:
+            raise ValueError("malformed SCRAM client-first message: %s" % (err,))
+        if not username:
+            raise ValueError("malformed SCRAM client-first message: empty username")
+        self.username = username
+
+        # look up keys
+        hash = self.server.lookup(username)
+        keys = None
+        if hash is not None:
+            try:
+                keys = self.server._get_keys(hash, self.alg)
+            except KeyError:
+                log.debug("scram hash for %r has no %s digest", username, self.alg)
+        if keys is None:
+            keys = self.server._get_fake_keys(username, self.alg, hash)
+        self._keys = keys
+        salt, rounds = keys[:2]
+
+        # generate server-first-message
+        if nonce is None:
+            nonce = _b64encode(os.urandom(self.server.nonce_size))
+        self._nonce = client_nonce + nonce
+        self._gs2_header = cbind_flag + "," + authzid + ","
+        self._server_first = "r=%s,s=%s,i=%d" % (self._nonce, _b64encode(salt), rounds)
+        self._client_first_bare = bare
+        self._state = "client-final"
+        return self._server_first
+
+    def process_client_final(self, message):
+        """
+        Process the client's final message, and return the server's final message.
+
+        :arg message: client-final-message, as unicode or utf-8 bytes.
+
+        :raises ValueError:
+            if the message is malformed (including a nonce or channel binding mismatch).
+
+        :returns:
+            server-final-message (as unicode). This is ``"v={signature}"`` if the client's
+            proof was valid (in which case :attr:`authenticated` will be set),
+            or ``"e=invalid-proof"`` if not (including when the user doesn't exist).
+        """
+        if self._state != "client-final":
+            raise RuntimeError("process_client_first() must be called first")
+        self._state = "done"
+        if isinstance(message, bytes):
+            message = message.decode("utf-8")
+
+        # parse client-final-message -- "c=cbind,r=nonce[,extensions],p=proof"
+        without_proof, sep, proof = message.rpartition(",p=")
+        if not sep:
+            raise ValueError("malformed SCRAM client-final message: missing proof")
+        cbind, nonce = _parse_attrs(without_proof, ("c", "r"))
+        if _b64decode(cbind) != self._gs2_header.encode("utf-8"):
+            raise ValueError("SCRAM channel binding mismatch")
+        if nonce != self._nonce:
+            raise ValueError("SCRAM nonce mismatch")
+        proof = _b64decode(proof)
+
+        # check proof
+        stored_key, client_hmac, server_hmac = self._keys[2:]
+        auth_message = ",".join([self._client_first_bare, self._server_first,
+                                 without_proof]).encode("utf-8")
+        if len(proof) != len(stored_key):
+            return "e=invalid-proof"
+        client_key = xor_bytes(proof, client_hmac(auth_message))
+        if not consteq(client_hmac.digest_info.const(client_key).digest(), stored_key):
+            return "e=invalid-proof"
+        self.authenticated = True
+        return "v=" + _b64encode(server_hmac(auth_message))
+
 #=============================================================================
 # code used for testing scram against protocol examples during development.
 #=============================================================================
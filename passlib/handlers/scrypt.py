@@ -351,6 +351,9 @@ class scrypt(uh.ParallelismMixin, uh.HasRounds, uh.HasRawSalt, uh.HasRawChecksum
 
     @classmethod
     def set_backend(cls, name="any", dryrun=False):
+        if name == "fastest":
+            # only native backend is worth using, no need to benchmark
+            name = "default"
         _scrypt._set_backend(name, dryrun=dryrun)
 
     #===================================================================
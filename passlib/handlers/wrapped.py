@@ -0,0 +1,345 @@
+"""passlib.handlers.wrapped - "onion" hashes which wrap a legacy hash inside a stronger one
+"""
+#=============================================================================
+# imports
+#=============================================================================
+# core
+from collections import deque
+import logging; log = logging.getLogger(__name__)
+# site
+# pkg
+from passlib.registry import get_crypt_handler
+from passlib.utils import to_unicode, to_native_str
+from passlib.utils.binary import ab64_encode, ab64_decode
+from passlib.utils.compat import unicode, native_string_types
+import passlib.utils.handlers as uh
+# local
+__all__ = [
+    "wrapped",
+    "WrappedHash",
+]
+
+#=============================================================================
+# handler
+#=============================================================================
+class WrappedHash(uh.MinimalHandler):
+    """Base class for hashes created by :func:`wrapped`.
+
+    Hashes have the format :samp:`$wrapped${inner}${config}${outer_hash}`,
+    where :samp:`{inner}` is the name of the inner hash,
+    :samp:`{config}` is the ab64-encoded configuration string of the inner hash
+    (the inner hash with its checksum blanked out, empty for unsalted hashes),
+    and :samp:`{outer_hash}` is the outer hash of the full inner hash string.
+    """
+    #===================================================================
+    # class attrs
+    #===================================================================
+
+    #: handler which generates the stored (outer) hash
+    outer = None
+
+    #: handler whose output is fed to :attr:`outer`
+    inner = None
+
+    #: handler passed to wrapped(), and settings applied to it via using() --
+    #: used to recreate :attr:`outer` inside wrap_many()'s worker processes.
+    _outer_base = None
+    _outer_settings = {}
+
+    #: prefix for all wrapped hashes
+    ident = u"$wrapped$"
+
+    # set by wrapped() to include inner name
+    _prefix = None
+
+    # informational attributes mirrored from outer hash
+    _outer_info_attrs = ("min_salt_size", "max_salt_size", "default_salt_size",
+                         "salt_chars", "default_salt_chars",
+                         "min_rounds", "max_rounds", "default_rounds", "rounds_cost")
+
+    @classmethod
+    def _set_outer(cls, outer):
+        """set outer hash, and mirror its informational attributes"""
+        cls.outer = outer
+        for attr in cls._outer_info_attrs:
+            if hasattr(outer, attr):
+                setattr(cls, attr, getattr(outer, attr))
+
+    #===================================================================
+    # configuration
+    #===================================================================
+    @classmethod
+    def using(cls, relaxed=False, **kwds):
+        # settings are passed through to outer hash
+        subcls = super(WrappedHash, cls).using(relaxed=relaxed)
+        if kwds:
+            subcls._set_outer(cls.outer.using(relaxed=relaxed, **kwds))
+            subcls._outer_settings = dict(cls._outer_settings, **kwds)
+        return subcls
+
+    #===================================================================
+    # parsing
+    #===================================================================
+    @classmethod
+    def identify(cls, hash):
+        hash = uh.to_unicode_for_identify(hash)
+        if not hash.startswith(cls._prefix):
+            return False
+        _, sep, outer_hash = hash[len(cls._prefix):].partition(u"$")
+        return bool(sep) and cls.outer.identify(outer_hash)
+
+    @classmethod
+    def _parse(cls, hash):
+        """parse hash into ``(inner config, outer hash)``"""
+        hash = to_unicode(hash, "ascii", "hash")
+        if not hash.startswith(cls._prefix):
+            raise uh.exc.InvalidHashError(cls)
+        config, sep, outer_hash = hash[len(cls._prefix):].partition(u"$")
+        if not sep:
+            raise uh.exc.MalformedHashError(cls)
+        try:
+            config = ab64_decode(config.encode("ascii")).decode("utf-8")
+        except (ValueError, TypeError, UnicodeDecodeError):
+            raise uh.exc.MalformedHashError(cls, "invalid inner config")
+        return config, outer_hash
+
+    @classmethod
+    def _render(cls, config, outer_hash):
+        """render inner config & outer hash into wrapped hash"""
+        config = ab64_encode(config.encode("utf-8")).decode("ascii")
+        return to_native_str(cls._prefix + config + u"$" + to_unicode(outer_hash, "ascii"))
+
+    #===================================================================
+    # inner hash helpers
+    #===================================================================
+    @classmethod
+    def _inner_config(cls, inner_hash, **context):
+        """return configuration string of inner hash (with checksum blanked out)"""
+        inner = cls.inner
+        if not inner.setting_kwds:
+            # unsalted hash -- nothing to store
+            if not inner.identify(inner_hash):
+                raise uh.exc.InvalidHashError(inner)
+            return u""
+        self = inner.from_string(inner_hash, **context)
+        self.checksum = self._stub_checksum
+        return to_unicode(self.to_string(), "ascii")
+
+    @classmethod
+    def _inner_hash(cls, secret, config, **context):
+        """recreate inner hash of secret, using stored configuration"""
+        inner = cls.inner
+        if config:
+            self = inner.from_string(config, **context)
+        else:
+            self = inner(**context)
+        self.checksum = self._calc_checksum(secret)
+        return self.to_string()
+
+    #===================================================================
+    # primary interface
+    #===================================================================
+    @classmethod
+    def hash(cls, secret, **context):
+        settings = uh.extract_settings_kwds(cls, context)
+        if settings:
+            uh.warn_hash_settings_deprecation(cls, settings)
+            return cls.using(**settings).hash(secret, **context)
+        secret = uh.validate_secret(secret)
+        return cls.wrap(cls.inner.hash(secret, **context), **context)
+
+    @classmethod
+    def verify(cls, secret, hash, **context):
+        secret = uh.validate_secret(secret)
+        config, outer_hash = cls._parse(hash)
+        return cls.outer.verify(cls._inner_hash(secret, config, **context), outer_hash)
+
+    @classmethod
+    def needs_update(cls, hash, secret=None):
+        _, outer_hash = cls._parse(hash)
+        return cls.outer.needs_update(outer_hash)
+
+    @uh.deprecated_method(deprecated="1.7", removed="2.0")
+    @classmethod
+    def genconfig(cls, **context):
+        return cls.hash("", **context)
+
+    @uh.deprecated_method(deprecated="1.7", removed="2.0")
+    @classmethod
+    def genhash(cls, secret, config, **context):
+        secret = uh.validate_secret(secret)
+        inner_config, outer_config = cls._parse(config)
+        inner_hash = cls._inner_hash(secret, inner_config, **context)
+        return cls._render(inner_config, cls.outer.genhash(inner_hash, outer_config))
+
+    #===================================================================
+    # offline migration
+    #===================================================================
+    @classmethod
+    def wrap(cls, inner_hash, **context):
+        """Convert an existing inner hash into a wrapped hash,
+        without needing the original password.
+
+        :raises ValueError:
+            if *inner_hash* isn't a valid hash for :attr:`inner`.
+        """
+        config, inner_hash = cls._prepare_wrap(inner_hash, **context)
+        return cls._render(config, cls.outer.hash(inner_hash))
+
+    @classmethod
+    def _prepare_wrap(cls, inner_hash, **context):
+        """helper for wrap() -- returns ``(inner config, normalized inner hash)``"""
+        config = cls._inner_config(inner_hash, **context)
+        # NOTE: normalizing inner hash to the same form verify() recreates via _inner_hash(),
+        #       otherwise non-canonical hashes (e.g. upper-case hex digests) would never verify.
+        inner_hash = cls.inner.from_string(inner_hash, **context).to_string()
+        return config, to_unicode(inner_hash, "ascii", "hash")
+
+    @classmethod
+    def wrap_many(cls, hashes, workers=None, processes=True, chunk_size=64,
+                  skip_unknown=False):
+        """Convert a sequence of inner hashes in parallel, using :func:`passlib.bulk.hash_records`.
+        This is meant for upgrading an entire credential store offline.
+
+        :arg hashes:
+            iterable of inner hashes (read incrementally, so this may be arbitrarily large).
+            Hashes which require context keywords (e.g. the ``user`` of
+            :class:`~passlib.hash.postgres_md5`) should be passed as ``(hash, context)`` pairs,
+            where *context* is a dict of keywords for :meth:`wrap`.
+
+        :param workers:
+            number of workers to use (defaults to number of cpus).
+
+        :param processes:
+            By default, the outer hashes are calculated by a pool of processes.
+            This requires the outer hash to be registered with passlib
+            (a :exc:`ValueError` is raised otherwise).
+            If ``False``, a pool of threads is used instead, which only helps for
+            backends that release the GIL (e.g. ``bcrypt``).
+            See :func:`~passlib.bulk.hash_records` for details.
+
+        :param chunk_size:
+            number of hashes sent to a worker at once (defaults to 64).
+
+        :param skip_unknown:
+            if ``True``, hashes which aren't recognized by :attr:`inner`
+            (e.g. ones which have already been wrapped or upgraded) are passed
+            through unchanged, instead of raising an error.
+
+        :returns:
+            iterator of wrapped hashes, in the same order as *hashes*.
+        """
+        from passlib.bulk import hash_records
+        # NOTE: only the outer hash is calculated by the workers; parsing the inner hashes
+        #       is cheap, and done here so errors are reported against the original input.
+        identify = cls.inner.identify
+        skipped = deque()
+
+        def records():
+            for idx, item in enumerate(hashes):
+                if isinstance(item, tuple):
+                    hash, context = item
+                else:
+                    hash, context = item, {}
+                if skip_unknown and not identify(hash):
+                    skipped.append((idx, hash))
+                    continue
+                config, inner_hash = cls._prepare_wrap(hash, **context)
+                yield (idx, config), inner_hash
+
+        results = hash_records(cls._get_outer_context(processes), records(), workers=workers,
+                               processes=processes, chunk_size=chunk_size)
+        return cls._iter_wrapped(results, skipped)
+
+    @classmethod
+    def _get_outer_context(cls, processes):
+        """helper for wrap_many() -- returns CryptContext which hashes using :attr:`outer`"""
+        from passlib.context import CryptContext
+        if not processes:
+            return CryptContext([cls.outer])
+        base = cls._outer_base
+        if get_crypt_handler(base.name, None) is not base:
+            raise ValueError("outer hash %r isn't registered, so can't be used by worker "
+                             "processes; use processes=False to use a thread pool instead" %
+                             (base.name,))
+        return CryptContext([base.name], **dict(
+            ("%s__%s" % (base.name, key), value)
+            for key, value in cls._outer_settings.items()
+        ))
+
+    @classmethod
+    def _iter_wrapped(cls, results, skipped):
+        """helper for wrap_many() -- renders results, merging skipped hashes back in order"""
+        for (idx, config), outer_hash in results:
+            # NOTE: record *idx* has been read by now, so any hashes skipped before it are queued
+            while skipped and skipped[0][0] < idx:
+                yield skipped.popleft()[1]
+            yield cls._render(config, outer_hash)
+        while skipped:
+            yield skipped.popleft()[1]
+
+    #===================================================================
+    # eoc
+    #===================================================================
+
+def wrapped(outer, inner, name=None):
+    """Create a hash which stores ``outer(inner(secret))``.
+
+    This allows an entire store of legacy hashes to be upgraded at once,
+    without knowing the users' passwords: each existing *inner* hash
+    is converted using :meth:`~WrappedHash.wrap` (or :meth:`~WrappedHash.wrap_many`),
+    after which verification requires computing the strong *outer* hash.
+
+    :arg outer:
+        handler (or name of handler) to use for the stored hash, e.g. ``"bcrypt"``.
+
+    :arg inner:
+        handler (or name of handler) of the legacy hash, e.g. ``"ldap_salted_sha1"``.
+        This must be a hash class derived from :class:`~passlib.utils.handlers.GenericHandler`.
+
+    :param name:
+        name of the new handler. defaults to :samp:`wrapped_{outer}_{inner}`.
+
+    :returns:
+        a new handler class, derived from :class:`WrappedHash`.
+        Any settings passed to its :meth:`~passlib.ifc.PasswordHash.using` method
+        are applied to the outer hash.
+
+    Usage example, which transparently verifies wrapped hashes,
+    and replaces them with plain bcrypt hashes as users log in::
+
+        >>> from passlib.handlers.wrapped import wrapped
+        >>> bcrypt_ssha = wrapped("bcrypt", "ldap_salted_sha1")
+        >>> new_hashes = list(bcrypt_ssha.wrap_many(old_hashes))
+        >>> ctx = CryptContext(["bcrypt", bcrypt_ssha], deprecated="auto")
+
+    .. note::
+
+        If the outer hash truncates passwords (e.g. bcrypt at 72 bytes),
+        only that prefix of the inner hash is protected by it.
+
+    .. versionadded:: 1.8
+    """
+    if isinstance(outer, native_string_types):
+        outer = get_crypt_handler(outer)
+    if isinstance(inner, native_string_types):
+        inner = get_crypt_handler(inner)
+    if not (isinstance(inner, type) and issubclass(inner, uh.GenericHandler)):
+        raise TypeError("inner hash must be a GenericHandler subclass: %r" % (inner,))
+    if name is None:
+        name = "wrapped_%s_%s" % (outer.name, inner.name)
+    cls = type(name, (WrappedHash,), dict(
+        __module__=__name__,
+        name=name,
+        inner=inner,
+        setting_kwds=outer.setting_kwds,
+        context_kwds=inner.context_kwds,
+        _prefix=WrappedHash.ident + unicode(inner.name) + u"$",
+    ))
+    cls._set_outer(outer)
+    cls._outer_base = outer
+    return cls
+
+#=============================================================================
+# eof
+#=============================================================================
@@ -0,0 +1,644 @@
+"""passlib.remote - serve a CryptContext to local processes over a unix socket
+
+This module provides a small daemon (:class:`ContextServer`, run via ``python -m passlib.remote``),
+which owns a single warmed-up :class:`~passlib.context.CryptContext`, and answers
+hash / verify requests from other processes on the same host;
+and a client (:class:`RemoteCryptContext`) which offers the same methods as the context.
+"""
+#=============================================================================
+# imports
+#=============================================================================
+# core
+from __future__ import absolute_import, division, print_function
+import json
+import logging; log = logging.getLogger(__name__)
+import os
+import socket
+import stat
+import struct
+import sys
+import threading
+# site
+# pkg
+from passlib.context import CryptContext
+from passlib.exc import _rebuild_error
+from passlib.utils import cpu_count, timer
+from passlib.utils.compat import unicode
+# local
+__all__ = [
+    "ContextServer",
+    "RemoteCryptContext",
+    "main",
+]
+
+#=============================================================================
+# wire protocol
+#=============================================================================
+#
+# all integers are big-endian.
+#
+#   frame    := u32 length, payload
+#   request  := u8 opcode, field*      -- secret, hash, category, then (name, value) kwd pairs
+#   response := u8 status, field*      -- see ContextServer._call() for each opcode's result fields
+#   field    := u32 length, bytes      -- length 0xFFFFFFFF (with no bytes) encodes None
+#
+# the opcode's high bit is set if the secret was unicode (sent as utf-8) rather than bytes.
+# on error, the status is STATUS_ERROR, and the fields are the error's class name & message.
+#
+
+OP_HASH = 1
+OP_VERIFY = 2
+OP_VERIFY_AND_UPDATE = 3
+OP_NEEDS_UPDATE = 4
+OP_STATS = 5
+
+_op_names = {
+    OP_HASH: "hash",
+    OP_VERIFY: "verify",
+    OP_VERIFY_AND_UPDATE: "verify_and_update",
+    OP_NEEDS_UPDATE: "needs_update",
+    OP_STATS: "stats",
+}
+
+_UNICODE_FLAG = 0x80
+
+STATUS_OK = 0
+STATUS_ERROR = 1
+
+_u32 = struct.Struct(">I")
+_NONE = 0xFFFFFFFF
+
+_TRUE = b"\x01"
+_FALSE = b"\x00"
+
+#: default limit on request size -- generous for any real secret & hash
+DEFAULT_MAX_REQUEST_SIZE = 1 << 16
+
+#: default limit on response size -- generous for any real hash or stats report
+DEFAULT_MAX_RESPONSE_SIZE = 1 << 16
+
+#: default limit on open client connections
+DEFAULT_MAX_CONNECTIONS = 64
+
+#: default number of seconds an idle client connection is kept open
+DEFAULT_TIMEOUT = 30
+
+def _encode_frame(head, fields):
+    """encode frame for u8 *head* & list of fields (bytes or None)"""
+    pack = _u32.pack
+    parts = [b"", struct.pack(">B", head)]
+    for field in fields:
+        if field is None:
+            parts.append(pack(_NONE))
+        else:
+            parts.append(pack(len(field)))
+            parts.append(field)
+    parts[0] = pack(sum(len(part) for part in parts))
+    return b"".join(parts)
+
+def _read_frame(rfile, max_size):
+    """
+    read frame from file, returning ``(head, fields)``, or ``None`` on clean EOF.
+
+    :raises EOFError: if connection closed mid-frame.
+    :raises ValueError: if frame is larger than *max_size*, or malformed.
+    """
+    header = rfile.read(4)
+    if not header:
+        return None
+    if len(header) != 4:
+        raise EOFError("connection closed mid-frame")
+    size, = _u32.unpack(header)
+    if size > max_size:
+        raise ValueError("frame too large: %d bytes" % size)
+    payload = rfile.read(size)
+    if len(payload) != size:
+        raise EOFError("connection closed mid-frame")
+    if not payload:
+        raise ValueError("empty frame")
+    head = bytearray(payload[:1])[0]
+    fields = []
+    offset = 1
+    unpack_from = _u32.unpack_from
+    while offset < size:
+        if offset + 4 > size:
+            raise ValueError("truncated field")
+        length, = unpack_from(payload, offset)
+        offset += 4
+        if length == _NONE:
+            fields.append(None)
+            continue
+        end = offset + length
+        if end > size:
+            raise ValueError("truncated field")
+        fields.append(payload[offset:end])
+        offset = end
+    return head, fields
+
+def _encode_str(value):
+    return None if value is None else value.encode("utf-8")
+
+def _decode_str(value):
+    return None if value is None else value.decode("utf-8")
+
+#=============================================================================
+# server
+#=============================================================================
+class ContextServer(object):
+    """Serve a :class:`~passlib.context.CryptContext` to local clients over a unix-domain socket.
+
+    :arg context:
+        the :class:`!CryptContext` to serve.
+
+    :arg path:
+        filesystem path of the socket to listen on.
+        A stale socket left at this path (e.g. by a crashed server) is replaced.
+
+    :param workers:
+        maximum number of requests to process concurrently (defaults to the number of cpus).
+        Connections beyond this wait their turn, so hashing never oversubscribes the host.
+
+    :param mode:
+        permissions for the socket file (defaults to ``0o600``, i.e. only the server's user
+        may connect). Any process which can connect can hash & verify with the context's policy,
+        so this should only be widened as far as the client services need.
+
+    :param warmup:
+        whether to call :meth:`CryptContext.warmup` before accepting connections (defaults to ``True``).
+
+    :param max_request_size:
+        maximum request size in bytes (larger requests cause the connection to be closed).
+
+    :param max_connections:
+        maximum number of client connections open at once (defaults to 64).
+        Each connection is served by its own thread, so further connections
+        are closed immediately, rather than letting idle clients use up threads & sockets.
+
+    :param timeout:
+        seconds a connection may sit idle (or take to send a request) before it's closed
+        (defaults to 30). :class:`RemoteCryptContext` transparently reconnects.
+
+    Usage::
+
+        >>> server = ContextServer(CryptContext.from_path("/etc/myapp/passlib.ini"),
+        ...                        "/run/myapp/passlibd.sock")
+        >>> server.serve_forever()
+
+    .. automethod:: serve_forever
+    .. automethod:: shutdown
+    .. automethod:: stats
+
+    .. versionadded:: 1.8
+    """
+    def __init__(self, context, path, workers=None, mode=0o600, warmup=True,
+                 max_request_size=DEFAULT_MAX_REQUEST_SIZE,
+                 max_connections=DEFAULT_MAX_CONNECTIONS, timeout=DEFAULT_TIMEOUT):
+        import socketserver
+        if not hasattr(socketserver, "UnixStreamServer"):
+            raise RuntimeError("unix-domain sockets not supported on this platform")
+        if workers is None:
+            workers = cpu_count()
+        if workers < 1:
+            raise ValueError("workers must be >= 1")
+        if max_connections < 1:
+            raise ValueError("max_connections must be >= 1")
+        self.context = context
+        self.path = path
+        self.workers = workers
+        self.max_request_size = max_request_size
+        self.max_connections = max_connections
+        self.timeout = timeout
+        self._slots = threading.BoundedSemaphore(workers)
+        self._connection_slots = threading.BoundedSemaphore(max_connections)
+
+        # metrics
+        self._stats_lock = threading.Lock()
+        self._started = timer()
+        self._ops = dict((name, dict(count=0, errors=0, busy=0.0, wait=0.0, max_wait=0.0))
+                         for name in _op_names.values() if name != "stats")
+        self._active = 0
+        self._connections = 0
+        self._total_connections = 0
+        self._rejected_connections = 0
+
+        if warmup:
+            context.warmup()
+
+        # remove stale socket
+        if os.path.exists(path):
+            if not stat.S_ISSOCK(os.stat(path).st_mode):
+                raise RuntimeError("not a socket: %r" % (path,))
+            try:
+                probe = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+                try:
+                    probe.connect(path)
+                finally:
+                    probe.close()
+            except socket.error:
+                os.unlink(path)
+            else:
+                raise RuntimeError("another server is already listening on %r" % (path,))
+
+        owner = self
+
+        class RequestHandler(socketserver.StreamRequestHandler):
+            # NOTE: applied as socket timeout, so reads from idle / stalled clients fail
+            timeout = owner.timeout
+
+            def handle(self):
+                owner._handle_connection(self.rfile, self.wfile)
+
+        class Server(socketserver.ThreadingMixIn, socketserver.UnixStreamServer):
+            daemon_threads = True
+
+            def verify_request(self, request, client_address):
+                # NOTE: checked before handler thread is started; rejected sockets are closed.
+                if owner._connection_slots.acquire(False):
+                    return True
+                with owner._stats_lock:
+                    owner._rejected_connections += 1
+                log.warning("rejecting connection: %d connections already open",
+                            owner.max_connections)
+                return False
+
+            def process_request(self, request, client_address):
+                try:
+                    socketserver.ThreadingMixIn.process_request(self, request, client_address)
+                except Exception:
+                    owner._connection_slots.release()
+                    raise
+
+            def finish_request(self, request, client_address):
+                # NOTE: releasing slot before socket is closed, so client can reconnect right away
+                try:
+                    socketserver.UnixStreamServer.finish_request(self, request, client_address)
+                finally:
+                    owner._connection_slots.release()
+
+        # NOTE: setting umask while binding, so socket is never briefly accessible
+        #       with wider permissions than requested.
+        orig = os.umask(0o777 & ~mode)
+        try:
+            self._server = Server(path, RequestHandler)
+        finally:
+            os.umask(orig)
+        os.chmod(path, mode)
+        self._serving = False
+        self._shutdown_lock = threading.Lock()
+
+    def serve_forever(self):
+        """handle requests until :meth:`shutdown` is called (from another thread)"""
+        log.info("serving %r on %r (%d workers)", self.context, self.path, self.workers)
+        self._serving = True
+        self._server.serve_forever()
+
+    def shutdown(self):
+        """stop :meth:`serve_forever` loop (if running), close socket, and remove socket file"""
+        with self._shutdown_lock:
+            server = self._server
+            if server is None:
+                return
+            self._server = None
+        # NOTE: server.shutdown() waits for serve_forever() to exit,
+        #       so would block forever if it was never called.
+        if self._serving:
+            server.shutdown()
+        server.server_close()
+        try:
+            os.unlink(self.path)
+        except OSError:
+            pass
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc_info):
+        self.shutdown()
+
+    def stats(self):
+        """
+        return dict of server metrics, containing ``"uptime"``, ``"workers"``,
+        ``"active"`` (requests being processed), ``"connections"`` (currently open),
+        ``"total_connections"``, ``"rejected_connections"`` (closed due to *max_connections*),
+        and ``"ops"`` -- which maps each operation to its
+        ``"count"``, ``"errors"``, ``"busy"`` (total seconds spent processing),
+        ``"wait"`` & ``"max_wait"`` (seconds spent waiting for a worker slot).
+        """
+        with self._stats_lock:
+            return dict(
+                uptime=timer() - self._started,
+                workers=self.workers,
+                active=self._active,
+                connections=self._connections,
+                total_connections=self._total_connections,
+                rejected_connections=self._rejected_connections,
+                ops=dict((name, dict(entry)) for name, entry in self._ops.items()),
+            )
+
+    def _handle_connection(self, rfile, wfile):
+        """serve requests from a single client connection until it closes"""
+        with self._stats_lock:
+            self._connections += 1
+            self._total_connections += 1
+        try:
+            while True:
+                try:
+                    frame = _read_frame(rfile, self.max_request_size)
+                except (EOFError, ValueError) as err:
+                    log.warning("closing connection: %s", err)
+                    return
+                if frame is None:
+                    return
+                wfile.write(self._dispatch(*frame))
+        except socket.error:
+            # client went away
+            return
+        finally:
+            with self._stats_lock:
+                self._connections -= 1
+
+    def _dispatch(self, opcode, fields):
+        """run request, returning encoded response"""
+        name = _op_names.get(opcode & ~_UNICODE_FLAG)
+        if name is None:
+            return _encode_frame(STATUS_ERROR, [b"ValueError", b"unknown opcode"])
+        if name == "stats":
+            return _encode_frame(STATUS_OK, [json.dumps(self.stats()).encode("utf-8")])
+        start = timer()
+        with self._slots:
+            begin = timer()
+            with self._stats_lock:
+                self._active += 1
+            try:
+                result = self._call(name, opcode & _UNICODE_FLAG, fields)
+            except Exception as err:
+                response = _encode_frame(STATUS_ERROR, [_encode_str(type(err).__name__),
+                                                        _encode_str(str(err))])
+                failed = True
+            else:
+                response = _encode_frame(STATUS_OK, result)
+                failed = False
+            end = timer()
+        wait = begin - start
+        with self._stats_lock:
+            self._active -= 1
+            entry = self._ops[name]
+            entry['count'] += 1
+            entry['errors'] += failed
+            entry['busy'] += end - begin
+            entry['wait'] += wait
+            if wait > entry['max_wait']:
+                entry['max_wait'] = wait
+        return response
+
+    def _call(self, name, unicode_secret, fields):
+        """decode request fields, invoke context method, and return encoded result fields"""
+        if len(fields) < 3 or len(fields) % 2 == 0:
+            raise ValueError("malformed request")
+        secret, hash, category = fields[:3]
+        if unicode_secret and secret is not None:
+            secret = secret.decode("utf-8")
+        context = self.context
+        # NOTE: only accepting context keywords (e.g. ``user``), so clients can't pass
+        #       settings such as ``rounds`` or ``salt`` through the deprecated kwds path,
+        #       or otherwise override the server's policy.
+        allowed = context.context_kwds | set(["user"])
+        kwds = {}
+        extra = fields[3:]
+        for idx in range(0, len(extra), 2):
+            key = _decode_str(extra[idx])
+            if key not in allowed:
+                raise TypeError("unexpected keyword: %r" % (key,))
+            kwds[key] = _decode_str(extra[idx + 1])
+        category = _decode_str(category)
+        hash = _decode_str(hash)
+        if name == "hash":
+            return [_encode_str(context.hash(secret, category=category, **kwds))]
+        elif name == "verify":
+            return [_TRUE if context.verify(secret, hash, category=category, **kwds) else _FALSE]
+        elif name == "verify_and_update":
+            valid, new_hash = context.verify_and_update(secret, hash, category=category, **kwds)
+            return [_TRUE if valid else _FALSE, _encode_str(new_hash)]
+        else:
+            assert name == "needs_update"
+            return [_TRUE if context.needs_update(hash, category=category, secret=secret)
+                    else _FALSE]
+
+#=============================================================================
+# client
+#=============================================================================
+class RemoteCryptContext(object):
+    """Client for a :class:`ContextServer`, offering the same hashing methods as :class:`~passlib.context.CryptContext`.
+
+    The client holds no hash backends or policy of its own -- every call is a round trip
+    to the server, which applies its context's configuration.  It keeps a small pool of
+    connections, and is safe to share between threads.
+
+    :arg path:
+        filesystem path of the server's socket.
+
+    :param timeout:
+        optional socket timeout in seconds.
+
+    :param pool_size:
+        maximum number of idle connections to keep open (defaults to 4).
+
+    :param max_response_size:
+        maximum response size in bytes (larger responses raise :exc:`ValueError`,
+        and the connection is closed).
+
+    Errors raised by the server's context (e.g. :exc:`ValueError` for unrecognized hashes)
+    are re-raised with the same class & message.  Connection problems raise :exc:`socket.error`.
+
+    .. automethod:: hash
+    .. automethod:: verify
+    .. automethod:: verify_and_update
+    .. automethod:: needs_update
+    .. automethod:: stats
+    .. automethod:: close
+
+    .. versionadded:: 1.8
+    """
+    def __init__(self, path, timeout=None, pool_size=4,
+                 max_response_size=DEFAULT_MAX_RESPONSE_SIZE):
+        self.path = path
+        self.timeout = timeout
+        self.pool_size = pool_size
+        self.max_response_size = max_response_size
+        self._pool = []
+        self._pool_lock = threading.Lock()
+
+    def __repr__(self):
+        return "<RemoteCryptContext %r>" % (self.path,)
+
+    #===================================================================
+    # connection pool
+    #===================================================================
+    def _connect(self):
+        sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        try:
+            if self.timeout is not None:
+                sock.settimeout(self.timeout)
+            sock.connect(self.path)
+        except Exception:
+            sock.close()
+            raise
+        return sock, sock.makefile("rb")
+
+    def _request(self, opcode, fields):
+        """send request, returning decoded response fields"""
+        data = _encode_frame(opcode, fields)
+        with self._pool_lock:
+            conn = self._pool.pop() if self._pool else None
+        # NOTE: if a pooled connection fails (e.g. server restarted since it was opened),
+        #       retrying once using a new one. all requests are safe to repeat.
+        for attempt in (0, 1):
+            reused = conn is not None
+            if conn is None:
+                conn = self._connect()
+            sock, rfile = conn
+            try:
+                sock.sendall(data)
+                frame = _read_frame(rfile, self.max_response_size)
+                if frame is None:
+                    raise EOFError("server closed connection")
+            except (socket.error, EOFError) as err:
+                self._close_conn(conn)
+                conn = None
+                if reused and not attempt:
+                    continue
+                if isinstance(err, EOFError):
+                    # e.g. server rejected connection (max_connections reached)
+                    raise socket.error("connection closed by server: %s" % err)
+                raise
+            except Exception:
+                self._close_conn(conn)
+                raise
+            break
+        with self._pool_lock:
+            if len(self._pool) < self.pool_size:
+                self._pool.append(conn)
+                conn = None
+        if conn is not None:
+            self._close_conn(conn)
+        status, fields = frame
+        if status != STATUS_OK:
+            raise _rebuild_error(_decode_str(fields[0]), _decode_str(fields[1]))
+        return fields
+
+    @staticmethod
+    def _close_conn(conn):
+        sock, rfile = conn
+        rfile.close()
+        sock.close()
+
+    def close(self):
+        """close all pooled connections"""
+        with self._pool_lock:
+            pool, self._pool = self._pool, []
+        for conn in pool:
+            self._close_conn(conn)
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc_info):
+        self.close()
+
+    #===================================================================
+    # context methods
+    #===================================================================
+    @staticmethod
+    def _encode_request(opcode, secret, hash, category, kwds):
+        if isinstance(secret, unicode):
+            secret = secret.encode("utf-8")
+            opcode |= _UNICODE_FLAG
+        elif secret is not None and not isinstance(secret, bytes):
+            raise TypeError("secret must be unicode or bytes")
+        if isinstance(hash, bytes):
+            hash = hash.decode("ascii")
+        fields = [secret, _encode_str(hash), _encode_str(category)]
+        for key, value in kwds.items():
+            if value is not None and not isinstance(value, unicode):
+                if not isinstance(value, bytes):
+                    raise TypeError("%s must be unicode or bytes" % key)
+                value = value.decode("utf-8")
+            fields.append(_encode_str(key))
+            fields.append(_encode_str(value))
+        return opcode, fields
+
+    def hash(self, secret, category=None, **kwds):
+        """hash secret using server's default scheme, see :meth:`CryptContext.hash`"""
+        return _decode_str(self._request(*self._encode_request(
+            OP_HASH, secret, None, category, kwds))[0])
+
+    def verify(self, secret, hash, category=None, **kwds):
+        """verify secret against hash, see :meth:`CryptContext.verify`"""
+        return self._request(*self._encode_request(
+            OP_VERIFY, secret, hash, category, kwds))[0] == _TRUE
+
+    def verify_and_update(self, secret, hash, category=None, **kwds):
+        """verify secret & check if hash needs updating, see :meth:`CryptContext.verify_and_update`"""
+        fields = self._request(*self._encode_request(
+            OP_VERIFY_AND_UPDATE, secret, hash, category, kwds))
+        return fields[0] == _TRUE, _decode_str(fields[1])
+
+    def needs_update(self, hash, category=None, secret=None):
+        """check if hash needs updating, see :meth:`CryptContext.needs_update`"""
+        return self._request(*self._encode_request(
+            OP_NEEDS_UPDATE, secret, hash, category, {}))[0] == _TRUE
+
+    def stats(self):
+        """return server's metrics (see :meth:`ContextServer.stats`)"""
+        return json.loads(_decode_str(self._request(OP_STATS, [])[0]))
+
+#=============================================================================
+# command line
+#=============================================================================
+def main(args=None):
+    """command line entry point"""
+    import argparse
+    import signal
+    parser = argparse.ArgumentParser(
+        prog="python -m passlib.remote",
+        description="Serve a CryptContext to local processes over a unix-domain socket.")
+    source = parser.add_mutually_exclusive_group(required=True)
+    source.add_argument("-c", "--config", help="CryptContext INI file to use")
+    source.add_argument("-s", "--scheme", help="name of hash scheme to use")
+    parser.add_argument("--section", default="passlib", help="INI section of config file")
+    parser.add_argument("-S", "--socket", required=True, help="path of socket to listen on")
+    parser.add_argument("-j", "--workers", type=int, default=None,
+                        help="max concurrent requests (defaults to number of cpus)")
+    parser.add_argument("-m", "--mode", type=lambda value: int(value, 8), default=0o600,
+                        help="socket file permissions, in octal (default: 600)")
+    parser.add_argument("--max-connections", type=int, default=DEFAULT_MAX_CONNECTIONS,
+                        help="max open client connections (default: %(default)s)")
+    parser.add_argument("--timeout", type=float, default=DEFAULT_TIMEOUT,
+                        help="seconds before idle connections are closed (default: %(default)s)")
+    opts = parser.parse_args(args)
+
+    logging.basicConfig(level=logging.INFO, format="%(asctime)s %(levelname)s %(message)s")
+    if opts.config:
+        context = CryptContext.from_path(opts.config, section=opts.section)
+    else:
+        context = CryptContext([opts.scheme])
+    server = ContextServer(context, opts.socket, workers=opts.workers, mode=opts.mode,
+                           max_connections=opts.max_connections, timeout=opts.timeout)
+
+    def stop(signum, frame):
+        threading.Thread(target=server.shutdown).start()
+    signal.signal(signal.SIGTERM, stop)
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+    finally:
+        server.shutdown()
+    return 0
+
+if __name__ == "__main__":
+    sys.exit(main())
+
+#=============================================================================
+# eof
+#=============================================================================
@@ -0,0 +1,221 @@
+"""passlib.tests -- test passlib.bulk"""
+#=============================================================================
+# imports
+#=============================================================================
+# core
+import io
+import json
+import logging; log = logging.getLogger(__name__)
+import sys
+# site
+# pkg
+from passlib.context import CryptContext
+from passlib.tests.utils import TestCase, set_file, get_file
+# subject
+from passlib.bulk import hash_records, verify_records, ProgressReporter, main
+# local
+__all__ = [
+    "BulkHashTest",
+]
+
+#=============================================================================
+# test cases
+#=============================================================================
+class BulkHashTest(TestCase):
+    descriptionPrefix = "passlib.bulk"
+
+    def setUp(self):
+        super(BulkHashTest, self).setUp()
+        self.context = CryptContext(["md5_crypt", "des_crypt"])
+
+    def check_results(self, records, results):
+        self.assertEqual([key for key, _ in results], [key for key, _ in records])
+        for (key, secret), (_, hash) in zip(records, results):
+            self.assertTrue(hash.startswith("$1$"))
+            self.assertTrue(self.context.verify(secret, hash))
+
+    def test_hash_records_threads(self):
+        """test hash_records() using threads"""
+        records = [("user%d" % idx, "secret%d" % idx) for idx in range(50)]
+        counts = []
+        results = list(hash_records(self.context, iter(records), workers=3, processes=False,
+                                    chunk_size=7, progress=counts.append))
+        self.check_results(records, results)
+        self.assertEqual(sum(counts), 50)
+        self.assertEqual(len(counts), 8)
+
+        self.assertRaises(ValueError, hash_records, self.context, records, workers=0)
+        self.assertRaises(ValueError, hash_records, self.context, records, chunk_size=0)
+
+    def test_hash_records_processes(self):
+        """test hash_records() using processes"""
+        records = [(idx, "secret%d" % idx) for idx in range(20)]
+        results = list(hash_records(self.context, records, workers=2, chunk_size=3))
+        self.check_results(records, results)
+
+    def test_verify_records(self):
+        """test verify_records()"""
+        from passlib.hash import phpass
+        handler = phpass.using(rounds=7)
+        records = []
+        for idx in range(10):
+            hash = handler.hash("secret%d" % idx)
+            records.append((idx, "secret%d" % idx if idx % 3 else "wrong", hash))
+        expected = [(idx, bool(idx % 3)) for idx in range(10)]
+        context = CryptContext(["phpass"])
+        self.assertEqual(list(verify_records(context, records, workers=2, processes=False,
+                                             chunk_size=3)), expected)
+        self.assertEqual(list(verify_records(context, records, workers=2, chunk_size=4)),
+                         expected)
+
+        # unknown hash
+        self.assertRaises(ValueError, list, verify_records(context, [(0, "x", "$1$abc")],
+                                                           processes=False))
+
+    def test_unregistered_handler(self):
+        """test process pool rejects context that workers can't recreate"""
+        from passlib.handlers.wrapped import wrapped
+        context = CryptContext(["sha256_crypt", wrapped("md5_crypt", "hex_md5")])
+        hash = context.handler("wrapped_md5_crypt_hex_md5").hash("pw")
+        records = [(1, "pw", hash)]
+        self.assertRaises(ValueError, verify_records, context, records, workers=1)
+        self.assertRaises(ValueError, hash_records, context, [(1, "pw")], workers=1)
+
+        # should work fine w/ threads
+        self.assertEqual(list(verify_records(context, records, workers=1, processes=False)),
+                         [(1, True)])
+
+    def _patch_interpreters(self):
+        """
+        replace concurrent.interpreters with stand-in which runs each "interpreter"
+        in a thread of this one (unless real module is available)
+        """
+        import passlib.bulk as bulk
+        if bulk._interpreters is not None:
+            return
+        import queue
+
+        class FakeInterpreter(object):
+            def __init__(self):
+                self.namespace = {}
+                self.closed = False
+
+            def prepare_main(self, **kwds):
+                self.namespace.update(kwds)
+
+            def exec(self, code):
+                exec(code, dict(self.namespace))
+
+            def close(self):
+                self.closed = True
+
+        class FakeModule(object):
+            create_queue = queue.Queue
+            create = FakeInterpreter
+
+        self.patchAttr(bulk, "_interpreters", FakeModule)
+
+    def test_interpreter_executor(self):
+        """test InterpreterExecutor"""
+        import passlib.bulk as bulk
+        from passlib.bulk import InterpreterExecutor
+        from passlib.exc import PasswordSizeError
+
+        self.patchAttr(bulk, "_interpreters", None)
+        self.assertRaises(RuntimeError, InterpreterExecutor, self.context)
+        self.assertEqual(main(["-", "-s", "md5_crypt", "-q", "--interpreters"]), 1)
+
+        self._patch_interpreters()
+        with InterpreterExecutor(self.context, workers=2) as executor:
+            hash = executor.hash("secret")
+            self.assertTrue(self.context.verify("secret", hash))
+            self.assertTrue(executor.verify("secret", hash))
+            self.assertFalse(executor.verify("wrong", hash))
+            self.assertEqual(executor.verify_and_update("secret", hash), (True, None))
+            self.assertEqual(executor.submit("identify", hash).result(), "md5_crypt")
+
+            # errors should be re-raised with same class
+            self.assertRaises(ValueError, executor.verify, "secret", "$x$abc")
+            self.assertRaises(PasswordSizeError, executor.hash, "x" * 5000)
+            self.assertRaises(ValueError, executor.submit, "load", "")
+
+            futures = [executor.submit("verify", "secret%d" % idx, hash) for idx in range(10)]
+            self.assertEqual([future.result() for future in futures], [False] * 10)
+        executor.shutdown()
+        self.assertRaises(RuntimeError, executor.submit, "hash", "secret")
+
+        # bulk interface
+        records = [("user%d" % idx, "secret%d" % idx) for idx in range(20)]
+        results = list(hash_records(self.context, records, workers=2, chunk_size=3,
+                                    processes="interpreters"))
+        self.check_results(records, results)
+        triples = [(key, "secret1", hash) for key, hash in results]
+        self.assertEqual(list(verify_records(self.context, triples, workers=2, chunk_size=3,
+                                             processes="interpreters")),
+                         [(key, key == "user1") for key, _ in results])
+
+    def test_progress(self):
+        """test ProgressReporter"""
+        stream = io.StringIO()
+        progress = ProgressReporter(total=10, stream=stream, interval=0)
+        progress(5)
+        progress.finish()
+        lines = stream.getvalue().splitlines()
+        self.assertEqual(len(lines), 2)
+        self.assertTrue(lines[0].startswith("5/10 records (50.0%)"))
+        self.assertIn("ETA", lines[0])
+        self.assertNotIn("ETA", lines[1])
+
+    def test_count_records(self):
+        """test record count used for progress totals"""
+        from passlib.bulk import _count_records
+        path = self.mktemp(suffix=".csv")
+        set_file(path, 'user,password\nalice,"pw\n1"\n\nbob,"p\nw\n2"\n')
+        self.assertEqual(_count_records(path, "csv"), 2)
+        set_file(path, "user,password\n")
+        self.assertEqual(_count_records(path, "csv"), 0)
+        set_file(path, '{"password": "pw1"}\n\n{"password": "pw2"}\n')
+        self.assertEqual(_count_records(path, "jsonl"), 2)
+
+    def test_main(self):
+        """test command line interface"""
+        # csv w/ key field
+        src = self.mktemp(suffix=".csv")
+        dst = self.mktemp()
+        set_file(src, "user,password\nalice,pw1\nbob,pw2\n")
+        self.assertEqual(main([src, "-o", dst, "-s", "md5_crypt", "-k", "user",
+                               "-j", "1", "-q", "--threads"]), 0)
+        lines = get_file(dst).decode("utf-8").splitlines()
+        self.assertEqual(lines[0], "user,hash")
+        self.assertEqual([line.split(",")[0] for line in lines[1:]], ["alice", "bob"])
+        self.assertTrue(self.context.verify("pw2", lines[2].split(",")[1]))
+
+        # jsonl w/o key field
+        src = self.mktemp(suffix=".jsonl")
+        set_file(src, '{"password": "pw1"}\n\n{"password": "pw2"}\n')
+        self.assertEqual(main([src, "-o", dst, "-s", "des_crypt", "-j", "1", "-q", "--threads"]), 0)
+        rows = [json.loads(line) for line in get_file(dst).decode("utf-8").splitlines()]
+        self.assertEqual([row["record"] for row in rows], [1, 2])
+        self.assertTrue(self.context.verify("pw1", rows[0]["hash"]))
+
+        # bad argument shouldn't truncate existing output
+        set_file(dst, "xxx")
+        self.assertEqual(main([src, "-o", dst, "-s", "des_crypt", "-j", "0", "-q"]), 1)
+        self.assertEqual(get_file(dst), b"xxx")
+
+        # missing field
+        set_file(src, '{"xxx": "pw1"}\n')
+        self.assertEqual(main([src, "-o", dst, "-s", "des_crypt", "-q", "--threads"]), 1)
+
+        # unknown scheme should be reported as usage error, without touching output
+        set_file(dst, "xxx")
+        stderr = io.StringIO()
+        self.patchAttr(sys, "stderr", stderr)
+        err = self.assertRaises(SystemExit, main, [src, "-o", dst, "-s", "xxx", "-q"])
+        self.assertEqual(err.code, 2)
+        self.assertIn("no crypt handler found for algorithm: 'xxx'", stderr.getvalue())
+        self.assertEqual(get_file(dst), b"xxx")
+
+#=============================================================================
+# eof
+#=============================================================================
@@ -17,7 +17,8 @@ import warnings
 # site
 # pkg
 from passlib import hash
-from passlib.context import CryptContext, LazyCryptContext
+from passlib.context import CryptContext, LazyCryptContext, ReloadingCryptContext, \
+    DeferredUpdater
 from passlib.exc import PasslibConfigWarning, PasslibHashWarning
 from passlib.utils import tick, to_unicode
 from passlib.utils.compat import irange, unicode, str_to_uascii, PY2, PY26
@@ -1595,6 +1596,132 @@ sha512_crypt__min_rounds = 45000
         # TODO: test dummy_verify() invoked by .verify() when hash is None,
         #       and same for .verify_and_update()
 
+    #===================================================================
+    # warmup()
+    #===================================================================
+    def test_warmup(self):
+        """warmup() method"""
+        from passlib.hash import md5_crypt
+        from passlib.utils.handlers import HasManyBackends, GenericHandler
+
+        class missing_backend(HasManyBackends, GenericHandler):
+            name = "missing_backend"
+            setting_kwds = ()
+            backends = ("a",)
+
+            @classmethod
+            def _load_backend_a(cls):
+                return False
+
+        ctx = CryptContext(["md5_crypt", "postgres_md5", "hex_md5", missing_backend],
+                           md5_crypt__salt_size=4)
+        for parallel in [True, False]:
+            ctx._reset_dummy_verify()
+            report = ctx.warmup(parallel=parallel)
+            self.assertEqual(list(report), ["md5_crypt", "postgres_md5", "hex_md5", "missing_backend"])
+
+            # should report backend & steps for each scheme
+            info = report["md5_crypt"]
+            self.assertIsNone(info["error"])
+            self.assertEqual(info["backend"], md5_crypt.get_backend())
+            self.assertEqual(list(info["steps"]), ["backend", "hash", "verify", "dummy_hash"])
+            self.assertTrue(all(value >= 0 for value in info["steps"].values()))
+            self.assertEqual(list(report["postgres_md5"]["steps"]), ["hash", "verify"])
+
+            # missing backend should be reported, not raised
+            info = report["missing_backend"]
+            self.assertIsNone(info["backend"])
+            self.assertIn("no backends available", info["error"])
+
+            # dummy hash should have been precalculated using default scheme's settings
+            self.assertIsNotNone(ctx._config.dummy_hash)
+            self.assertEqual(len(ctx._dummy_hash.split("$")[2]), 4)
+            self.assertTrue(md5_crypt.verify(ctx._dummy_secret, ctx._dummy_hash))
+
+        # subset of schemes
+        self.assertEqual(list(ctx.warmup(["hex_md5"])), ["hex_md5"])
+        self.assertRaises(KeyError, ctx.warmup, ["des_crypt"])
+        self.assertEqual(CryptContext().warmup(), {})
+
+    def test_trace(self):
+        """trace() method"""
+        from passlib.hash import md5_crypt
+        ctx = CryptContext(["md5_crypt", "hex_md5", "postgres_md5"], deprecated=["hex_md5"])
+        h1 = ctx.hash("test")
+        h2 = ctx.handler("hex_md5").hash("test")
+        h3 = ctx.handler("postgres_md5").hash("test", user="user")
+        seen = []
+
+        with ctx.trace(size=3, callback=seen.append) as tracer:
+            # verify() should be traced, and broken into phases where possible
+            self.assertTrue(ctx.verify("test", h1))
+            rec = tracer.records[-1]
+            self.assertEqual(rec["name"], "passlib.verify")
+            self.assertGreaterEqual(rec["end_time"], rec["start_time"])
+            attrs = rec["attributes"]
+            self.assertEqual(attrs["passlib.scheme"], "md5_crypt")
+            self.assertEqual(attrs["passlib.backend"], md5_crypt.get_backend())
+            self.assertTrue(attrs["passlib.verified"])
+            self.assertEqual(sorted(k for k in attrs if k.startswith("passlib.phase.")),
+                             ["passlib.phase.compare", "passlib.phase.identify",
+                              "passlib.phase.kdf", "passlib.phase.parse"])
+
+            # handlers which override verify() are timed as a whole;
+            # unused context kwds should be stripped same as usual.
+            valid, new_hash = ctx.verify_and_update("test", h2, user="user")
+            self.assertTrue(valid)
+            self.assertTrue(md5_crypt.verify("test", new_hash))
+            self.assertFalse(ctx.verify("wrong", h3, user="user"))
+            attrs = tracer.records[-2]["attributes"]
+            self.assertEqual(attrs["passlib.scheme"], "hex_md5")
+            self.assertIsNone(attrs["passlib.backend"])
+            self.assertIn("passlib.phase.verify", attrs)
+            self.assertIn("passlib.phase.rehash", attrs)
+            self.assertFalse(tracer.records[-1]["attributes"]["passlib.verified"])
+
+            # errors should be recorded, then re-raised
+            self.assertRaises(ValueError, ctx.verify, "test", "$bad$")
+            self.assertEqual(tracer.records[-1]["attributes"]["passlib.error"],
+                             "ValueError: hash could not be identified")
+
+            # ring buffer should be bounded, callback should see everything
+            self.assertEqual(len(tracer.records), 3)
+            self.assertEqual(len(seen), 4)
+
+            # scheme kwd is traced the same way, hash=None is traced as verify of dummy hash
+            with warnings.catch_warnings():
+                warnings.filterwarnings("ignore", ".*'scheme' keyword is deprecated", DeprecationWarning)
+                self.assertTrue(ctx.verify("test", h1, scheme="md5_crypt"))
+            self.assertEqual(len(seen), 5)
+            self.assertIn("passlib.phase.kdf", seen[-1]["attributes"])
+            self.assertFalse(ctx.verify("test", None))
+            self.assertEqual(len(seen), 6)
+            attrs = seen[-1]["attributes"]
+            self.assertEqual(attrs["passlib.scheme"], "md5_crypt")
+            self.assertFalse(attrs["passlib.verified"])
+            self.assertIn("passlib.phase.kdf", attrs)
+            self.assertEqual(ctx.verify_and_update("test", None), (False, None))
+            self.assertEqual(seen[-1]["name"], "passlib.verify_and_update")
+            self.assertNotIn("passlib.phase.needs_update", seen[-1]["attributes"])
+
+        # should be disabled on exit, without having touched instance methods
+        self.assertNotIn("verify", ctx.__dict__)
+        self.assertIsNone(ctx._tracer)
+        self.assertTrue(ctx.verify("test", h1))
+        self.assertEqual(len(seen), 7)
+
+        # broken callback shouldn't break verify; calling trace() again replaces tracer
+        def callback(record):
+            raise RuntimeError("oops")
+        tracer = ctx.trace(size=0, callback=callback)
+        self.assertIsNone(tracer.records)
+        self.assertTrue(ctx.verify("test", h1))
+        tracer2 = ctx.trace()
+        tracer.close()
+        self.assertIs(ctx._tracer, tracer2)
+        tracer2.close()
+        self.assertIsNone(ctx._tracer)
+
     #===================================================================
     # feature tests
     #===================================================================
@@ -1630,6 +1757,38 @@ sha512_crypt__min_rounds = 45000
         self.assertRaises(ValueError, CryptContext, "sha256_crypt,md5_crypt",
                           deprecated="md5_crypt,auto")
 
+    def test_62_compile(self):
+        """test compile=True option"""
+        from passlib.hash import ldap_salted_sha1, sha256_crypt, bcrypt
+
+        # should be parsed as bool, and round-trip through to_string()
+        ctx = CryptContext(["sha256_crypt", "ldap_salted_sha1", "des_crypt"],
+                           sha256_crypt__default_rounds=5000, compile="true")
+        self.assertEqual(ctx.to_dict()['compile'], True)
+        self.assertEqual(CryptContext.from_string(ctx.to_string()).to_dict(), ctx.to_dict())
+        self.assertRaises(KeyError, CryptContext, ["sha256_crypt"], admin__context__compile=True)
+
+        # records should be compiled variants of the configured handlers
+        for scheme in ["sha256_crypt", "ldap_salted_sha1", "des_crypt"]:
+            record = ctx.handler(scheme)
+            self.assertTrue(record._compiled)
+            self.assertFalse(ctx.copy(compile=False).handler(scheme)._compiled)
+        self.assertTrue(issubclass(ctx.handler("sha256_crypt"), sha256_crypt))
+
+        # and still honor the configured settings
+        for scheme in ["sha256_crypt", "ldap_salted_sha1", "des_crypt"]:
+            hash = ctx.handler(scheme).hash("test")
+            self.assertTrue(ctx.verify("test", hash))
+            self.assertFalse(ctx.verify("wrong", hash))
+            self.assertFalse(ctx.needs_update(hash))
+        self.assertEqual(sha256_crypt.from_string(ctx.hash("test")).rounds, 5000)
+        self.assertTrue(ctx.needs_update(sha256_crypt.using(rounds=6000).hash("test")) is False)
+
+        # validation should still reject malformed hashes
+        hash = ctx.handler("ldap_salted_sha1").hash("test")
+        self.assertRaises(ValueError, ctx.verify, "test", hash[:-4])
+        self.assertRaises(ValueError, ctx.verify, "test", "$5$rounds=5000$bad*salt$" + "a" * 43)
+
     def test_disabled_hashes(self):
         """disabled hash support"""
         #
@@ -1779,6 +1938,220 @@ class LazyCryptContextTest(TestCase):
 
         self.assertTrue(has_crypt_handler("dummy_2", True))
 
+class ReloadingCryptContextTest(TestCase):
+    descriptionPrefix = "ReloadingCryptContext"
+
+    def test_path_source(self):
+        """test reloading from path"""
+        path = self.mktemp()
+        set_file(path, "[passlib]\nschemes = md5_crypt, des_crypt\n")
+        cc = ReloadingCryptContext(path)
+        self.assertEqual(cc.schemes(), ("md5_crypt", "des_crypt"))
+        self.assertIsNotNone(cc._config.dummy_hash)
+        hash = cc.hash("test")
+        self.assertTrue(cc.verify("test", hash))
+
+        # nothing changed
+        self.assertFalse(cc.reload_if_changed())
+
+        # change default, and bump mtime (in case fs resolution is too coarse)
+        set_file(path, "[passlib]\nschemes = md5_crypt, des_crypt\ndefault = des_crypt\n")
+        st = os.stat(path)
+        os.utime(path, (st.st_atime, st.st_mtime + 5))
+        self.assertTrue(cc.reload_if_changed())
+        self.assertFalse(cc.reload_if_changed())
+        self.assertEqual(cc.default_scheme(), "des_crypt")
+        self.assertTrue(cc.verify("test", hash))
+        self.assertEqual(cc.identify(cc._dummy_hash), "des_crypt")
+
+        # invalid config should leave previous config in place
+        set_file(path, "[passlib]\nschemes = md5_crypt, xxx_unknown\n")
+        os.utime(path, (st.st_atime, st.st_mtime + 10))
+        self.assertRaises(KeyError, cc.reload_if_changed)
+        self.assertEqual(cc.schemes(), ("md5_crypt", "des_crypt"))
+
+        # missing file / wrong source type
+        self.assertRaises(EnvironmentError, ReloadingCryptContext, path + "xxx")
+        self.assertRaises(TypeError, ReloadingCryptContext, 123)
+
+    def test_callable_source(self):
+        """test reloading from callable"""
+        state = dict(schemes=["sha256_crypt", "md5_crypt"], sha256_crypt__default_rounds=5000)
+        cc = ReloadingCryptContext(lambda: dict(state))
+        self.assertEqual(cc.schemes(), ("sha256_crypt", "md5_crypt"))
+        self.assertFalse(cc.reload_if_changed())
+
+        hash = cc.hash("test")
+        state.update(sha256_crypt__default_rounds=6000, sha256_crypt__min_rounds=6000)
+        self.assertTrue(cc.reload_if_changed())
+        self.assertTrue(cc.needs_update(hash))
+        self.assertFalse(cc.needs_update(cc.hash("test")))
+
+        # force should reload even if unchanged
+        self.assertFalse(cc.reload_if_changed())
+        self.assertTrue(cc.reload())
+
+        # reload should only replace the config object, and leave the old one intact
+        # (so callers holding a snapshot of it keep seeing a consistent config)
+        old_config = cc._config
+        old_attrs = dict(vars(cc))
+        state.update(schemes=["des_crypt"])
+        self.assertTrue(cc.reload())
+        self.assertIsNot(cc._config, old_config)
+        self.assertEqual(set(vars(cc)), set(old_attrs))
+        self.assertEqual([key for key in old_attrs if old_attrs[key] is not vars(cc)[key]],
+                         ["_config", "_source_token"])
+        self.assertEqual(old_config.identify_record(old_config.dummy_hash, None).name,
+                         "sha256_crypt")
+        self.assertEqual(cc.identify(cc._dummy_hash), "des_crypt")
+        self.assertFalse(cc.verify("test", None))
+
+    def test_watcher(self):
+        """test background watcher thread"""
+        state = dict(schemes=["md5_crypt", "des_crypt"])
+        cc = ReloadingCryptContext(lambda: dict(state), interval=0.01)
+        self.addCleanup(cc.stop)
+        self.assertRaises(RuntimeError, cc.start, 0.01)
+
+        # concurrent verify() calls shouldn't ever fail while config is swapped
+        hash = cc.handler("des_crypt").hash("test")
+        state['default'] = "des_crypt"
+        end = time.time() + 5
+        while cc.default_scheme() != "des_crypt" and time.time() < end:
+            self.assertTrue(cc.verify("test", hash))
+        self.assertEqual(cc.default_scheme(), "des_crypt")
+
+        cc.stop()
+        self.assertIs(cc._watcher, None)
+        cc.stop()
+
+class DeferredUpdaterTest(TestCase):
+    descriptionPrefix = "DeferredUpdater"
+
+    def test_verify_and_update(self):
+        """test deferred verify_and_update()"""
+        ctx = CryptContext(["sha256_crypt", "md5_crypt", "des_crypt"],
+                           deprecated=["des_crypt"], sha256_crypt__default_rounds=5000)
+        results = []
+        updater = ctx.defer_updates(lambda ref, old, new: results.append((ref, old, new)))
+        self.assertIsInstance(updater, DeferredUpdater)
+        self.addCleanup(updater.close, False)
+
+        # wrong password / missing hash shouldn't queue anything
+        des_hash = ctx.handler("des_crypt").hash("test")
+        self.assertFalse(updater.verify_and_update("wrong", des_hash, "u1"))
+        self.assertFalse(updater.verify_and_update("test", None, "u1"))
+
+        # up-to-date hash shouldn't queue anything
+        self.assertTrue(updater.verify_and_update("test", ctx.hash("test"), "u1"))
+        updater.join()
+        self.assertEqual(results, [])
+
+        # deprecated hash should be queued, and rehashed with default scheme
+        self.assertTrue(updater.verify_and_update("test", des_hash, "u2"))
+        updater.join()
+        self.assertEqual(len(results), 1)
+        ref, old_hash, new_hash = results[0]
+        self.assertEqual(ref, "u2")
+        self.assertEqual(old_hash, des_hash)
+        self.assertEqual(ctx.identify(new_hash), "sha256_crypt")
+        self.assertTrue(ctx.verify("test", new_hash))
+        self.assertEqual(updater.completed, 1)
+        self.assertEqual(updater.pending, 0)
+
+        # callback errors should be logged and discarded
+        def bad_callback(ref, old, new):
+            raise ValueError("xxx")
+        updater2 = ctx.defer_updates(bad_callback)
+        self.assertTrue(updater2.verify_and_update("test", des_hash, "u3"))
+        updater2.close()
+        self.assertEqual(updater2.completed, 1)
+        self.assertRaises(RuntimeError, updater2.verify_and_update, "test", des_hash, "u3")
+
+        # bad options
+        self.assertRaises(ValueError, ctx.defer_updates, bad_callback, policy="xxx")
+        self.assertRaises(ValueError, ctx.defer_updates, bad_callback, max_pending=0)
+        self.assertRaises(ValueError, ctx.defer_updates, bad_callback, workers=0)
+        self.assertRaises(TypeError, ctx.defer_updates, None)
+
+    def test_queue_policy(self):
+        """test queue overflow policies"""
+        import threading
+        ctx = CryptContext(["md5_crypt", "des_crypt"], deprecated=["des_crypt"])
+        des_hash = ctx.handler("des_crypt").hash("test")
+        gate = threading.Event()
+        results = []
+
+        def callback(ref, old, new):
+            gate.wait()
+            results.append(ref)
+
+        # "drop" -- extra re-hashes should be counted and discarded
+        updater = ctx.defer_updates(callback, max_pending=2)
+        self.addCleanup(gate.set)
+        for idx in irange(6):
+            self.assertTrue(updater.verify_and_update("test", des_hash, idx))
+        # worker holds 1 task, queue holds 2, so at least 3 should be dropped.
+        self.assertGreaterEqual(updater.dropped, 3)
+        gate.set()
+        updater.close()
+        self.assertEqual(len(results) + updater.dropped, 6)
+        self.assertEqual(results, sorted(results))
+
+        # "block" -- nothing should be dropped
+        gate.clear()
+        del results[:]
+        updater = ctx.defer_updates(callback, max_pending=1, policy="block", workers=2)
+        def producer():
+            for idx in irange(5):
+                updater.verify_and_update("test", des_hash, idx)
+        thread = threading.Thread(target=producer)
+        thread.start()
+        quicksleep(0.05)
+        self.assertTrue(thread.is_alive())
+        gate.set()
+        thread.join()
+        updater.close()
+        self.assertEqual(sorted(results), list(irange(5)))
+        self.assertEqual(updater.dropped, 0)
+
+    def test_password_change_race(self):
+        """test callback can skip re-hash if password changed while it was pending"""
+        import threading
+        ctx = CryptContext(["md5_crypt", "des_crypt"], deprecated=["des_crypt"])
+        des_hash = ctx.handler("des_crypt").hash("test")
+        database = {"u1": des_hash, "u2": des_hash}
+        lock = threading.Lock()
+        gate = threading.Event()
+        skipped = []
+
+        def callback(ref, old, new):
+            # compare-and-set, as an "UPDATE ... WHERE hash = old" would
+            gate.wait()
+            with lock:
+                if database[ref] == old:
+                    database[ref] = new
+                else:
+                    skipped.append(ref)
+
+        updater = ctx.defer_updates(callback)
+        self.addCleanup(gate.set)
+        self.assertTrue(updater.verify_and_update("test", des_hash, "u1"))
+        self.assertTrue(updater.verify_and_update("test", des_hash, "u2"))
+
+        # user changes password before re-hash is persisted
+        changed = ctx.hash("changed")
+        with lock:
+            database["u1"] = changed
+        gate.set()
+        updater.close()
+
+        # changed password should be kept, other account upgraded
+        self.assertEqual(skipped, ["u1"])
+        self.assertEqual(database["u1"], changed)
+        self.assertEqual(ctx.identify(database["u2"]), "md5_crypt")
+        self.assertTrue(ctx.verify("test", database["u2"]))
+
 #=============================================================================
 # eof
 #=============================================================================
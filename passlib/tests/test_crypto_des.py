@@ -189,6 +189,29 @@ class DesTest(TestCase):
         # check invalid rounds
         self.assertRaises(ValueError, des_encrypt_int_block, 0, 0, 0, rounds=0)
 
+    def test_05_static_tables(self):
+        """des & blowfish tables are immutable compile-time constants"""
+        import platform
+        if platform.python_implementation() != "CPython":
+            raise self.skipTest("relies on CPython constant folding")
+        from passlib.crypto import des
+        from passlib.crypto._blowfish import base
+
+        def is_constant(func, value):
+            return any(const is value for const in func.__code__.co_consts)
+
+        des._load_tables()
+        for name in ["IE3264", "SPE", "CF6464"]:
+            table = getattr(des, name)
+            self.assertIsInstance(table, tuple)
+            self.assertTrue(is_constant(des._load_tables, table), name)
+
+        base._init_constants()
+        for name in ["BLOWFISH_P", "BLOWFISH_S"]:
+            table = getattr(base, name)
+            self.assertIsInstance(table, tuple)
+            self.assertTrue(is_constant(base._init_constants, table), name)
+
 #=============================================================================
 # eof
 #=============================================================================
@@ -146,8 +146,60 @@ class HashInfoTest(TestCase):
 
         self.assertRaises(TypeError, lookup_hash, 123)
 
+    def test_digest_many(self):
+        """digest_many()"""
+        from passlib.crypto.digest import digest_many
+        messages = [b"", b"abc", b"\x00" * 100]
+        self.assertEqual(digest_many("sha1", messages),
+                         [hashlib.sha1(msg).digest() for msg in messages])
+        self.assertEqual(digest_many(hashlib.md5, messages[1:2]),
+                         [hashlib.md5(b"abc").digest()])
+        self.assertEqual(digest_many("sha256", []), [])
+
     # TODO: write full test of compile_hmac() -- currently relying on pbkdf2_hmac() tests
 
+    def test_compile_hmac_cache(self):
+        """compile_hmac() -- cache option"""
+        import hmac
+        from passlib.crypto import digest as mod
+        from passlib.crypto.digest import compile_hmac, clear_hmac_cache
+
+        clear_hmac_cache()
+        self.addCleanup(clear_hmac_cache)
+        key = b"k" * 20
+        msg = b"\x00" * 8
+        ref = hmac.new(key, msg, hashlib.sha1).digest()
+
+        # cached function should be reused, and equivalent to uncached one
+        h1 = compile_hmac("sha1", key, cache=True)
+        self.assertEqual(h1(msg), ref)
+        self.assertIs(compile_hmac("sha1", key.decode("ascii"), cache=True), h1)
+        self.assertIsNot(compile_hmac("sha1", key), h1)
+        self.assertEqual(h1.digest_info.name, "sha1")
+        self.assertEqual(h1(msg), ref)
+
+        # digest, key, and multipart flag should all be part of index
+        self.assertIsNot(compile_hmac("sha256", key, cache=True), h1)
+        self.assertIsNot(compile_hmac("sha1", b"x" + key, cache=True), h1)
+        update, finalize = compile_hmac("sha1", key, multipart=True, cache=True)()
+        update(msg)
+        self.assertEqual(finalize(), ref)
+
+        # cache shouldn't contain raw keys
+        for ckey in mod._hmac_cache:
+            self.assertNotIn(key, ckey)
+
+        # cache should be bounded, evicting least recently used entries
+        self.patchAttr(mod, "HMAC_CACHE_SIZE", 2)
+        clear_hmac_cache()
+        h1 = compile_hmac("sha1", b"a", cache=True)
+        h2 = compile_hmac("sha1", b"b", cache=True)
+        self.assertIs(compile_hmac("sha1", b"a", cache=True), h1)
+        compile_hmac("sha1", b"c", cache=True)
+        self.assertEqual(len(mod._hmac_cache), 2)
+        self.assertIs(compile_hmac("sha1", b"a", cache=True), h1)
+        self.assertIsNot(compile_hmac("sha1", b"b", cache=True), h2)
+
 #=============================================================================
 # test PBKDF1 support
 #=============================================================================
@@ -494,6 +546,72 @@ class Pbkdf2Test(TestCase):
         self.assertEqual(len(helper(digest='sha1')), 20)
         self.assertEqual(len(helper(digest='sha256')), 32)
 
+    def test_compile_pbkdf(self):
+        """test compile_pbkdf()"""
+        from passlib.crypto.digest import compile_pbkdf, pbkdf1
+
+        # pbkdf2 should match reference vectors, for all backends
+        for row in self.pbkdf2_test_vectors:
+            correct, secret, salt, rounds, keylen = row[:5]
+            digest = row[5] if len(row) == 6 else "sha1"
+            engine = compile_pbkdf("pbkdf2", digest, keylen)
+            self.assertEqual(engine(secret, salt, rounds), correct)
+
+        # pbkdf1 should match pbkdf1()
+        engine = compile_pbkdf("pbkdf1", "sha1", 16)
+        self.assertEqual(engine(b"password", b"salt", 100), pbkdf1("sha1", b"password", b"salt", 100, 16))
+
+        # unicode should be encoded as utf-8
+        for kdf in ["pbkdf1", "pbkdf2"]:
+            engine = compile_pbkdf(kdf, "sha256")
+            self.assertEqual(engine(u"\u00e9", u"salt", 3), engine(b"\xc3\xa9", b"salt", 3))
+
+        # engines should be cached
+        self.assertIs(compile_pbkdf("pbkdf2", "sha512", 64), compile_pbkdf("pbkdf2", "sha512", 64))
+
+        # cache should be bounded, evicting least recently used entries
+        from collections import OrderedDict
+        import passlib.crypto.digest as mod
+        self.patchAttr(mod, "PBKDF_ENGINE_CACHE_SIZE", 2)
+        self.patchAttr(mod, "_pbkdf_engine_cache", OrderedDict())
+        e1 = compile_pbkdf("pbkdf2", "sha1", 10)
+        compile_pbkdf("pbkdf2", "sha1", 11)
+        self.assertIs(compile_pbkdf("pbkdf2", "sha1", 10), e1)
+        compile_pbkdf("pbkdf2", "sha1", 12)
+        self.assertEqual(len(mod._pbkdf_engine_cache), 2)
+        self.assertIs(compile_pbkdf("pbkdf2", "sha1", 10), e1)
+
+        # keylen & kdf should be validated up front
+        self.assertRaises(ValueError, compile_pbkdf, "pbkdf3", "sha1")
+        self.assertRaises(ValueError, compile_pbkdf, "pbkdf1", "sha1", 21)
+        self.assertRaises(ValueError, compile_pbkdf, "pbkdf2", "sha1", 0)
+        self.assertRaises(ValueError, compile_pbkdf, "pbkdf2", "foo")
+
+    def test_pbkdf2_hmac_many(self):
+        """test pbkdf2_hmac_many()"""
+        from passlib.crypto.digest import pbkdf2_hmac, pbkdf2_hmac_many
+
+        pairs = [(b"password", b"salt"), (u"\u00e9", u"salt"), (b"", b"x" * 40), (b"password", b"salt")]
+        for digest, keylen in [("sha1", None), ("sha256", 20), ("sha512", 80)]:
+            expected = [pbkdf2_hmac(digest, secret, salt, 10, keylen) for secret, salt in pairs]
+            # NOTE: workers=3 exercises thread pool (if backend supports it), even on single-cpu hosts.
+            for workers in [None, 1, 3]:
+                self.assertEqual(pbkdf2_hmac_many(digest, pairs, 10, keylen, workers=workers), expected)
+        self.assertEqual(pbkdf2_hmac_many("sha1", [], 10), [])
+
+        # thread pool should be created once, and shared between calls
+        from passlib.crypto import digest as digest_mod
+        if getattr(digest_mod.compile_pbkdf("pbkdf2", "sha1"), "releases_gil", False):
+            pool = digest_mod._get_thread_pool()
+            pbkdf2_hmac_many("sha1", pairs, 10, workers=2)
+            self.assertIs(digest_mod._get_thread_pool(), pool)
+
+        # inputs should be validated up front
+        self.assertRaises(TypeError, pbkdf2_hmac_many, "sha1", [(b"password", 1)], 10)
+        self.assertRaises(TypeError, pbkdf2_hmac_many, "sha1", pairs, 1.5)
+        self.assertRaises(ValueError, pbkdf2_hmac_many, "sha1", pairs, 0)
+        self.assertRaises(ValueError, pbkdf2_hmac_many, "sha1", pairs, 10, 0)
+
 #=============================================================================
 # eof
 #=============================================================================
@@ -6,6 +6,7 @@
 from __future__ import absolute_import, division, print_function
 import logging; log = logging.getLogger(__name__)
 import sys
+import time
 # site
 # pkg
 from passlib import apps as _apps, exc, registry
@@ -100,6 +101,35 @@ if has_min_django:
             # NOTE: ignoring update_fields for test purposes
             self.saved_passwords.append(self.password)
 
+    class FakeBackend(object):
+        """mock auth backend, which loads FakeUser from :attr:`database`"""
+        #: map of pk -> password hash
+        database = {}
+
+        def get_user(self, user_id):
+            if user_id not in self.database:
+                return None
+            user = FakeUser()
+            user.pk = user_id
+            user.password = self.database[user_id]
+            return user
+
+class FakeSession(dict):
+    """mock session object for use with django's login() / get_user()"""
+
+    def cycle_key(self):
+        pass
+
+    def flush(self):
+        self.clear()
+
+class FakeRequest(object):
+    """mock request object for use with django's login() / get_user()"""
+
+    def __init__(self, session=None):
+        self.session = FakeSession() if session is None else session
+        self.META = {}
+
 def create_mock_setter():
     state = []
     def setter(password):
@@ -229,7 +259,8 @@ class _ExtensionSupport(object):
     #===================================================================
     # load / unload the extension (and verify it worked)
     #===================================================================
-    _config_keys = ["PASSLIB_CONFIG", "PASSLIB_CONTEXT", "PASSLIB_GET_CATEGORY"]
+    _config_keys = ["PASSLIB_CONFIG", "PASSLIB_CONTEXT", "PASSLIB_GET_CATEGORY",
+                    "PASSLIB_DEFERRED_UPGRADES"]
     def load_extension(self, check=True, **kwds):
         """helper to load extension with specified config & patch django"""
         self.unload_extension()
@@ -796,10 +827,215 @@ class DjangoExtensionTest(_ExtensionTest):
         self.assertRaises(TypeError, self.load_extension, PASSLIB_CONTEXT=config,
                           PASSLIB_GET_CATEGORY='x')
 
+    #===================================================================
+    # PASSLIB_DEFERRED_UPGRADES setting
+    #===================================================================
+    def test_31_deferred_upgrades(self):
+        """test PASSLIB_DEFERRED_UPGRADES setting"""
+        from passlib.hash import des_crypt
+        config = dict(schemes=["sha256_crypt", "des_crypt"], deprecated=["des_crypt"],
+                      sha256_crypt__default_rounds=1000)
+        self.load_extension(PASSLIB_CONFIG=config, PASSLIB_DEFERRED_UPGRADES=dict(batch_size=10))
+        from passlib.ext.django.models import adapter
+        upgrades = adapter.deferred_upgrades
+        self.assertEqual(upgrades.batch_size, 10)
+
+        # upgrade should be queued, rather than saved
+        user = FakeUser()
+        user.pk = 1
+        old_hash = user.password = des_crypt.hash("stub")
+        self.assertTrue(user.check_password("stub"))
+        self.assertEqual(user.pop_saved_passwords(), [])
+        self.assertEqual(upgrades.pending, 1)
+        # user.password should still match database until upgrade is flushed
+        self.assertEqual(user.password, old_hash)
+
+        # unloading should flush & detach
+        upgrades._update_rows = lambda model, rows: len(rows)
+        self.unload_extension()
+        self.assertEqual(upgrades.pending, 0)
+
+        # bad value
+        self.assertRaises(TypeError, self.load_extension, PASSLIB_CONFIG=config,
+                          PASSLIB_DEFERRED_UPGRADES="x")
+
+    def test_32_deferred_upgrades_login(self):
+        """test PASSLIB_DEFERRED_UPGRADES doesn't invalidate session created by login()"""
+        from django.contrib.auth import login, get_user
+        from passlib.hash import des_crypt
+        config = dict(schemes=["sha256_crypt", "des_crypt"], deprecated=["des_crypt"],
+                      sha256_crypt__default_rounds=1000)
+        self.load_extension(PASSLIB_CONFIG=config, PASSLIB_DEFERRED_UPGRADES=True)
+        from passlib.ext.django.models import adapter
+        upgrades = adapter.deferred_upgrades
+
+        # fake database & auth backend, which reloads user from it
+        database = {1: des_crypt.hash("stub")}
+        backend_path = __name__ + ".FakeBackend"
+        self.addCleanup(update_settings,
+                        AUTHENTICATION_BACKENDS=settings.AUTHENTICATION_BACKENDS,
+                        SECRET_KEY=settings.SECRET_KEY)
+        update_settings(AUTHENTICATION_BACKENDS=[backend_path], SECRET_KEY="test")
+        FakeBackend.database = database
+
+        user = FakeBackend().get_user(1)
+        self.assertTrue(user.check_password("stub"))
+        self.assertEqual(upgrades.pending, 1)
+
+        # login, then load user for next request (before upgrade is flushed)
+        request = FakeRequest()
+        user.backend = backend_path
+        login(request, user)
+        self.assertEqual(get_user(FakeRequest(request.session)).pk, 1)
+
+        # once flushed, database & session hash should both be updated
+        def update_rows(model, rows):
+            for pk, old, new in rows:
+                if database[pk] == old:
+                    database[pk] = new
+            return len(rows)
+        upgrades._update_rows = update_rows
+        self.assertEqual(upgrades.flush(), 1)
+        self.assertFalse(des_crypt.identify(database[1]))
+        user = FakeBackend().get_user(1)
+        self.assertTrue(user.check_password("stub"))
+        self.assertEqual(upgrades.pending, 0)
+
     #===================================================================
     # eoc
     #===================================================================
 
+class DjangoTranslatorTest(TestCase):
+    """test DjangoTranslator's precomputed hasher tables (doesn't require django)"""
+    descriptionPrefix = "DjangoTranslator"
+
+    def test_hasher_tables(self):
+        context = CryptContext(["md5_crypt", "des_crypt"])
+        translator = DjangoTranslator(context=context)
+        expected = [translator.passlib_to_django(name, cached=False) for name in context.schemes()]
+
+        translator.build_hasher_tables()
+        md5_crypt = context.handler("md5_crypt")
+        des_crypt = context.handler("des_crypt")
+
+        # lookups should come from table
+        hasher = translator.passlib_to_django(md5_crypt)
+        self.assertIs(translator.passlib_to_django("md5_crypt"), hasher)
+        self.assertIs(translator.resolve_django_hasher("default"), hasher)
+        self.assertIs(translator.resolve_django_hasher(hasher.algorithm), hasher)
+        self.assertEqual(hasher.algorithm, expected[0].algorithm)
+        self.assertIs(translator.django_to_passlib("passlib_des_crypt"), des_crypt)
+        self.assertIs(translator.django_to_passlib("default"), md5_crypt)
+
+        # reloading context should invalidate tables
+        context.load(dict(schemes=["des_crypt"]))
+        self.assertIsNot(translator.django_to_passlib("default"), md5_crypt)
+        self.assertRaises(KeyError, translator.django_to_passlib, "passlib_md5_crypt")
+
+        # as should reset_hashers()
+        translator.build_hasher_tables()
+        self.assertIsNotNone(translator._hasher_tables)
+        translator.reset_hashers()
+        self.assertIsNone(translator._hasher_tables)
+
+class DeferredUpgradesTest(TestCase):
+    """test DeferredUpgrades batching logic (doesn't require django)"""
+    descriptionPrefix = "DeferredUpgrades"
+
+    def test_batching(self):
+        from passlib.ext.django.utils import DeferredUpgrades
+
+        class User(object):
+            def __init__(self, pk):
+                self.pk = pk
+
+        class Admin(User):
+            pass
+
+        written = []
+        upgrades = DeferredUpgrades(batch_size=2)
+        upgrades._update_rows = lambda model, rows: written.append((model, rows)) or len(rows)
+
+        self.assertFalse(upgrades._is_due())
+        upgrades.add(User(1), "a1", "b1")
+        self.assertFalse(upgrades._is_due())
+        # repeated upgrade should keep original hash for the conditional update
+        upgrades.add(User(1), "b1", "c1")
+        upgrades.add(User(2), "a2", "b2")
+        upgrades.add(User(3), "a3", "b3")
+        upgrades.add(Admin(1), "a4", "b4")
+        self.assertEqual(upgrades.pending, 4)
+        self.assertTrue(upgrades._is_due())
+
+        # should be grouped by model, and split into batch_size chunks
+        self.assertEqual(upgrades.flush(), 4)
+        self.assertEqual(written, [
+            (User, [(1, "a1", "c1"), (2, "a2", "b2")]),
+            (User, [(3, "a3", "b3")]),
+            (Admin, [(1, "a4", "b4")]),
+        ])
+        self.assertEqual(upgrades.pending, 0)
+        self.assertEqual(upgrades.flush(), 0)
+
+        # max_delay should trigger flush
+        upgrades = DeferredUpgrades(batch_size=100, max_delay=0.01)
+        upgrades.add(User(1), "a1", "b1")
+        self.assertFalse(upgrades._is_due())
+        time.sleep(0.02)
+        self.assertTrue(upgrades._is_due())
+
+        # errors should be logged, not raised
+        def bad(model, rows):
+            raise RuntimeError("xxx")
+        upgrades._update_rows = bad
+        self.assertEqual(upgrades.flush(), 0)
+
+        self.assertRaises(ValueError, DeferredUpgrades, batch_size=0)
+        self.assertRaises(ValueError, DeferredUpgrades, max_delay=0)
+
+    def test_update_rows_race(self):
+        """test _update_rows() skips rows whose password changed since they were verified"""
+        if not has_min_django:
+            raise self.skipTest("Django not installed")
+        from django.db.models import Q
+        from passlib.ext.django.utils import DeferredUpgrades
+
+        # fake manager which applies UPDATE to in-memory table,
+        # evaluating the filter & CASE expressions it was given.
+        table = {1: "a1", 2: "changed", 3: "a3"}
+
+        def matches(q, pk):
+            row = dict(pk=pk, password=table[pk])
+            found = [matches(child, pk) if isinstance(child, Q) else row[child[0]] == child[1]
+                     for child in q.children]
+            result = any(found) if q.connector == Q.OR else all(found)
+            return result != q.negated
+
+        class Manager(object):
+            def filter(self, where):
+                self.where = where
+                return self
+
+            def update(self, password):
+                count = 0
+                for pk in sorted(table):
+                    if not matches(self.where, pk):
+                        continue
+                    count += 1
+                    for when in password.cases:
+                        if matches(when.condition, pk):
+                            table[pk] = when.result.value
+                            break
+                return count
+
+        class User(object):
+            _default_manager = Manager()
+
+        # row 2's password was changed after its upgrade was queued
+        rows = [(1, "a1", "b1"), (2, "a2", "b2"), (3, "a3", "b3")]
+        self.assertEqual(DeferredUpgrades._update_rows(User, rows), 2)
+        self.assertEqual(table, {1: "b1", 2: "changed", 3: "b3"})
+
 #=============================================================================
 # eof
 #=============================================================================
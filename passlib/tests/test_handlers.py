@@ -365,6 +365,21 @@ class fshp_test(HandlerCase):
         self.assertRaises(ValueError, handler, variant='9', **kwds)
         self.assertRaises(ValueError, handler, variant=9, **kwds)
 
+    def test_91_engine_bound_to_class(self):
+        """test compiled engines are bound to handler class, not looked up per hash"""
+        from passlib.crypto import digest
+        handler = self.handler.using(rounds=10)
+        hash = handler.hash("password")
+
+        # further hashes shouldn't consult compile_pbkdf()'s global cache
+        digest._pbkdf_engine_cache.clear()
+        self.assertTrue(handler.verify("password", hash))
+        for variant in range(4):
+            obj = handler(variant=variant, use_defaults=True)
+            obj.checksum = obj._calc_checksum("password")
+            self.assertTrue(handler.verify("password", obj.to_string()))
+        self.assertEqual(len(digest._pbkdf_engine_cache), 0)
+
 #=============================================================================
 # hex digests
 #=============================================================================
@@ -1647,6 +1662,104 @@ class unix_disabled_test(HandlerCase):
         self.assertRaises(ValueError, handler.hash, 'stub', marker='abc')
         self.assertRaises(ValueError, handler.using, marker='abc')
 
+#=============================================================================
+# wrapped hashes
+#=============================================================================
+from passlib.handlers.wrapped import wrapped
+
+class wrapped_test(HandlerCase):
+    handler = wrapped("md5_crypt", "hex_md5")
+
+    known_correct_hashes = [
+        ("password", "$wrapped$hex_md5$$$1$JRpw..zY$g/BXjKh4c3Jycgi6oTVsc0"),
+        (UPASS_TABLE, "$wrapped$hex_md5$$$1$ZC6QUwwi$porO3mwEQxHb46oH6Q3l3."),
+    ]
+
+    known_unidentified_hashes = [
+        # plain inner & outer hashes
+        "5f4dcc3b5aa765d61d8327deb882cf99",
+        "$1$JRpw..zY$g/BXjKh4c3Jycgi6oTVsc0",
+        # wrong inner hash
+        "$wrapped$hex_sha1$$$1$JRpw..zY$g/BXjKh4c3Jycgi6oTVsc0",
+    ]
+
+    known_malformed_hashes = [
+        # outer hash malformed
+        "$wrapped$hex_md5$$$1$JRpw..zY$g/BXjKh4c3Jycgi6oTVsc!",
+    ]
+
+    def test_90_wrap(self):
+        """test wrap() & wrap_many() offline conversion"""
+        from passlib.context import CryptContext
+        for inner in [hash.hex_md5, hash.ldap_salted_sha1, hash.des_crypt, hash.mysql41]:
+            handler = wrapped(hash.md5_crypt, inner)
+            self.assertEqual(handler.name, "wrapped_md5_crypt_" + inner.name)
+            old = [inner.hash("test"), inner.hash("pass")]
+            new = list(handler.wrap_many(old, workers=2))
+            self.assertEqual(len(new), 2)
+            self.assertTrue(handler.verify("test", new[0]))
+            self.assertFalse(handler.verify("pass", new[0]))
+            self.assertTrue(handler.verify("pass", new[1]))
+
+            # context should verify, then replace with default hash on login
+            ctx = CryptContext([hash.sha256_crypt, handler], deprecated="auto")
+            self.assertEqual(ctx.identify(new[0]), handler.name)
+            ok, replacement = ctx.verify_and_update("test", new[0])
+            self.assertTrue(ok)
+            self.assertTrue(hash.sha256_crypt.identify(replacement))
+
+        # non-canonical inner hashes should be normalized before wrapping
+        handler = wrapped("md5_crypt", "hex_md5")
+        self.assertTrue(handler.verify("test", handler.wrap(hash.hex_md5.hash("test").upper())))
+        handler = wrapped("md5_crypt", "mysql41")
+        self.assertTrue(handler.verify("test", handler.wrap(hash.mysql41.hash("test").lower())))
+
+        # skip_unknown
+        handler = wrapped("md5_crypt", "ldap_salted_sha1")
+        other = hash.md5_crypt.hash("test")
+        self.assertRaises(ValueError, list, handler.wrap_many([other]))
+        self.assertEqual(list(handler.wrap_many([other], skip_unknown=True)), [other])
+        old = [other, hash.ldap_salted_sha1.hash("test"), other, other,
+               hash.ldap_salted_sha1.hash("pass"), other]
+        new = list(handler.wrap_many(old, workers=2, chunk_size=1, skip_unknown=True))
+        self.assertEqual([new[idx] for idx in (0, 2, 3, 5)], [other] * 4)
+        self.assertTrue(handler.verify("test", new[1]))
+        self.assertTrue(handler.verify("pass", new[4]))
+
+        # settings should be passed to outer hash (including in worker processes)
+        subcls = handler.using(salt_size=4)
+        self.assertEqual(len(hash.md5_crypt.from_string(
+            subcls._parse(subcls.hash("test"))[1]).salt), 4)
+        result, = subcls.wrap_many([hash.ldap_salted_sha1.hash("test")], workers=1)
+        self.assertEqual(len(hash.md5_crypt.from_string(subcls._parse(result)[1]).salt), 4)
+        self.assertTrue(subcls.verify("test", result))
+
+        # unregistered outer hash requires threads
+        handler = wrapped(hash.md5_crypt.using(salt_size=4), "hex_md5")
+        old = [hash.hex_md5.hash("test")]
+        self.assertRaises(ValueError, handler.wrap_many, old, workers=1)
+        result, = handler.wrap_many(old, workers=1, processes=False)
+        self.assertEqual(len(hash.md5_crypt.from_string(handler._parse(result)[1]).salt), 4)
+        self.assertTrue(handler.verify("test", result))
+
+        # inner must be a GenericHandler
+        self.assertRaises(TypeError, wrapped, "md5_crypt", "unix_disabled")
+
+    def test_91_context_kwds(self):
+        """test inner hash context kwds"""
+        handler = wrapped("md5_crypt", "postgres_md5")
+        self.assertEqual(handler.context_kwds, ("user",))
+        result = handler.wrap(hash.postgres_md5.hash("test", user="bob"), user="bob")
+        self.assertTrue(handler.verify("test", result, user="bob"))
+        self.assertFalse(handler.verify("test", result, user="alice"))
+
+        # wrap_many() should accept per-record context
+        old = [(hash.postgres_md5.hash("test", user="bob"), dict(user="bob")),
+               (hash.postgres_md5.hash("pass", user="alice"), dict(user="alice"))]
+        new = list(handler.wrap_many(old, workers=2))
+        self.assertTrue(handler.verify("test", new[0], user="bob"))
+        self.assertTrue(handler.verify("pass", new[1], user="alice"))
+
 #=============================================================================
 # eof
 #=============================================================================
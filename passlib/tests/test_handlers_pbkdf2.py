@@ -103,6 +103,19 @@ class pbkdf2_sha256_test(HandlerCase):
             ),
     ]
 
+    def test_90_engine_bound_to_class(self):
+        """test compiled engine is bound to handler class, not looked up per hash"""
+        from passlib.crypto import digest
+        handler = self.handler.using(rounds=1000)
+        secret = "password"
+        hash = handler.hash(secret)
+
+        # further hashes shouldn't consult compile_pbkdf()'s global cache
+        digest._pbkdf_engine_cache.clear()
+        self.assertTrue(handler.verify(secret, hash))
+        self.assertTrue(handler.verify(secret, handler.hash(secret)))
+        self.assertEqual(len(digest._pbkdf_engine_cache), 0)
+
 class pbkdf2_sha512_test(HandlerCase):
     handler = hash.pbkdf2_sha512
     known_correct_hashes = [
@@ -474,6 +487,141 @@ class scram_test(HandlerCase):
         self.assertRaises(ValueError, vfull, 'pencil', h)
         self.assertRaises(ValueError, vfull, 'tape', h)
 
+    def test_97_extract_server_keys(self):
+        """test scram.extract_server_keys()"""
+        from binascii import a2b_base64
+        # reference values from rfc 5802 example
+        h = '$scram$4096$QSXCR.Q6sek8bf92$sha-1=HZbuOlKbWl.eR8AfIposuKbhX30'
+        salt, rounds, stored_key, server_key = self.handler.extract_server_keys(h, "SCRAM-SHA-1")
+        self.assertEqual(salt, a2b_base64(b"QSXCR+Q6sek8bf92"))
+        self.assertEqual(rounds, 4096)
+        self.assertEqual(stored_key, a2b_base64(b"6dlGYMOdZcOPutkcNY8U2g7vK9Y="))
+        self.assertEqual(server_key, a2b_base64(b"D+CSWLOshSulAsxiupA+qs2/fTE="))
+        self.assertRaises(KeyError, self.handler.extract_server_keys, h, "sha-256")
+
+    def test_98_server_exchange(self):
+        """test ScramServer"""
+        from base64 import b64encode
+        from binascii import a2b_base64
+        import hashlib
+        import hmac
+        from passlib.handlers.scram import ScramServer
+        from passlib.utils import xor_bytes
+
+        # build hash matching rfc 5802 (sha-1) & rfc 7677 (sha-256) examples
+        def make_hash(salt):
+            salt = a2b_base64(salt)
+            return self.handler(salt=salt, rounds=4096, checksum=dict(
+                (alg, self.handler.derive_digest("pencil", salt, 4096, alg))
+                for alg in ["sha-1", "sha-256"])).to_string()
+        users = {u"user": make_hash(b"QSXCR+Q6sek8bf92")}
+        lookups = []
+        def lookup(username):
+            lookups.append(username)
+            return users.get(username)
+        server = ScramServer(lookup)
+
+        # rfc 5802 example
+        exchange = server.exchange("SCRAM-SHA-1")
+        self.assertEqual(exchange.process_client_first(
+            "n,,n=user,r=fyko+d2lbbFgONRv9qkxdawL", nonce="3rfcNHYJY1ZVvWVs7j"),
+            "r=fyko+d2lbbFgONRv9qkxdawL3rfcNHYJY1ZVvWVs7j,s=QSXCR+Q6sek8bf92,i=4096")
+        self.assertEqual(exchange.username, u"user")
+        self.assertEqual(exchange.process_client_final(
+            "c=biws,r=fyko+d2lbbFgONRv9qkxdawL3rfcNHYJY1ZVvWVs7j,"
+            "p=v0X8v3Bz2T0CJGbJQyF0X+HI4Ts="), "v=rmF9pqV8S7suAoZWja4dJRkFsKQ=")
+        self.assertTrue(exchange.authenticated)
+        self.assertRaises(RuntimeError, exchange.process_client_final, "c=biws")
+
+        # rfc 7677 example (uses same password, different salt) --
+        # also checks changed hash isn't shadowed by cache entry for old one
+        users[u"user"] = make_hash(b"W22ZaJ0SNY7soEsUEjb6gQ==")
+        first = "n,,n=user,r=rOprNGfwEbeRWgbNEkqO"
+        nonce = "%hvYDpWUa2RaTCAfuxFIlj)hNlF$k0"
+        final = ("c=biws,r=rOprNGfwEbeRWgbNEkqO%hvYDpWUa2RaTCAfuxFIlj)hNlF$k0,"
+                 "p=dHzbZapWIk4jUhN+Ute9ytag9zjfMHgsqmmiz7AndVQ=")
+        for _ in range(2):
+            exchange = server.exchange("sha-256")
+            exchange.process_client_first(first.encode("ascii"), nonce=nonce)
+            self.assertEqual(exchange.process_client_final(final),
+                             "v=6rriTRBi23WpRR/wtup+mMhUZUn/dB5nLTJRsjl95G4=")
+        self.assertEqual(len(server._cache), 2)
+
+        # wrong proof
+        exchange = server.exchange("sha-256")
+        exchange.process_client_first(first, nonce=nonce)
+        self.assertEqual(exchange.process_client_final(final.replace("p=dH", "p=dA")),
+                         "e=invalid-proof")
+        self.assertFalse(exchange.authenticated)
+
+        # nonce & channel binding mismatches
+        exchange = server.exchange("sha-256")
+        exchange.process_client_first(first, nonce="xxx")
+        self.assertRaises(ValueError, exchange.process_client_final, final)
+        exchange = server.exchange("sha-256")
+        exchange.process_client_first(first, nonce=nonce)
+        self.assertRaises(ValueError, exchange.process_client_final,
+                          final.replace("c=biws", "c=eSws"))
+
+        # unknown user, and user w/o requested digest, should look like normal exchange,
+        # with same salt each time
+        for username in [u"nobody", u"user"]:
+            results = []
+            for _ in range(2):
+                exchange = server.exchange("sha-512")
+                results.append(exchange.process_client_first(
+                    "n,,n=%s,r=abc" % username, nonce="def"))
+            self.assertEqual(results[0], results[1])
+            self.assertTrue(results[0].endswith(",i=4096"))
+            self.assertEqual(exchange.process_client_final(
+                "c=biws,r=abcdef,p=" + "A" * 86 + "=="), "e=invalid-proof")
+        self.assertIn(u"s=W22ZaJ0SNY7soEsUEjb6gQ==,", results[0])
+
+        # fake records should have same rounds & salt size as existing users' records,
+        # even when those differ from the scram defaults
+        def parse_first(message):
+            attrs = dict(part.split("=", 1) for part in message.split(","))
+            return len(a2b_base64(attrs["s"])), int(attrs["i"])
+        custom = {u"alice": self.handler.using(rounds=2000, salt_size=7).hash("pw")}
+        for policy in [None, self.handler.using(rounds=2000, salt_size=7)]:
+            other = ScramServer(custom.get, policy=policy)
+            shapes = [parse_first(other.exchange("sha-256").process_client_first(
+                      "n,,n=%s,r=abc" % username)) for username in [u"alice", u"mallory"]]
+            self.assertEqual(shapes, [(7, 2000)] * 2)
+
+        # username escaping & authzid
+        exchange = server.exchange("sha-1")
+        exchange.process_client_first("y,a=ad=3Dmin,n=a=2Cb,r=abc")
+        self.assertEqual(exchange.username, u"a,b")
+        self.assertEqual(exchange.authzid, u"ad=min")
+        self.assertEqual(lookups[-1], u"a,b")
+
+        # escaped username should be unescaped & saslprep-ed before lookup,
+        # and authenticate using the message as sent
+        users[u"a,b=c"] = make_hash(b"QSXCR+Q6sek8bf92")
+        exchange = server.exchange("sha-1")
+        bare = u"n=a=2C\u00adb=3Dc,r=abc"
+        server_first = exchange.process_client_first(u"n,," + bare, nonce="def")
+        self.assertEqual(lookups[-1], u"a,b=c")
+        self.assertEqual(exchange.username, u"a,b=c")
+        salted = self.handler.derive_digest("pencil", a2b_base64(b"QSXCR+Q6sek8bf92"), 4096, "sha-1")
+        client_key = hmac.new(salted, b"Client Key", hashlib.sha1).digest()
+        without_proof = u"c=biws,r=abcdef"
+        auth_message = u",".join([bare, server_first, without_proof]).encode("utf-8")
+        signature = hmac.new(hashlib.sha1(client_key).digest(), auth_message, hashlib.sha1).digest()
+        proof = xor_bytes(client_key, signature)
+        exchange.process_client_final(without_proof + u",p=" + b64encode(proof).decode("ascii"))
+        self.assertTrue(exchange.authenticated)
+
+        # malformed messages (including usernames saslprep rejects, or which end up empty)
+        for message in ["n,,r=abc", "n,,n=user", "p=tls-unique,,n=user,r=abc",
+                        "n,,m=ext,n=user,r=abc", "n,,n=us=er,r=abc", "n,n=user,r=abc",
+                        u"n,,n=us\u0007er,r=abc", u"n,,n=\u00ad,r=abc"]:
+            self.assertRaises(ValueError, server.exchange("sha-1").process_client_first, message)
+
+        server.clear_cache()
+        self.assertEqual(len(server._cache), 0)
+
 #=============================================================================
 # eof
 #=============================================================================
@@ -0,0 +1,201 @@
+"""passlib.tests -- test passlib.remote"""
+#=============================================================================
+# imports
+#=============================================================================
+# core
+import os
+import socket
+import stat
+import threading
+import logging; log = logging.getLogger(__name__)
+# site
+# pkg
+from passlib.context import CryptContext
+from passlib.exc import PasswordSizeError
+from passlib.tests.utils import TestCase
+# subject
+from passlib.remote import ContextServer, RemoteCryptContext, _encode_frame, _read_frame
+# local
+__all__ = [
+    "RemoteContextTest",
+]
+
+#=============================================================================
+# test cases
+#=============================================================================
+class RemoteContextTest(TestCase):
+    descriptionPrefix = "passlib.remote"
+
+    def setUp(self):
+        super(RemoteContextTest, self).setUp()
+        if not hasattr(socket, "AF_UNIX"):
+            raise self.skipTest("unix-domain sockets not supported")
+        self.context = CryptContext(["md5_crypt", "sha256_crypt", "des_crypt", "postgres_md5"],
+                                    deprecated=["des_crypt"],
+                                    sha256_crypt__default_rounds=1000,
+                                    admin__context__default="sha256_crypt")
+
+    def start_server(self, **kwds):
+        """start server in background thread, returning it & its socket path"""
+        path = self.mktemp(suffix=".sock")
+        os.remove(path)
+        server = ContextServer(self.context, path, workers=2, **kwds)
+        self.addCleanup(server.shutdown)
+        thread = threading.Thread(target=server.serve_forever)
+        thread.daemon = True
+        thread.start()
+        return server, path
+
+    def test_protocol(self):
+        """test frame encoding"""
+        import io
+        data = _encode_frame(3, [b"abc", None, b""])
+        self.assertEqual(data, b"\x00\x00\x00\x10\x03\x00\x00\x00\x03abc"
+                               b"\xff\xff\xff\xff\x00\x00\x00\x00")
+        stream = io.BytesIO(data + data[:6])
+        self.assertEqual(_read_frame(stream, 100), (3, [b"abc", None, b""]))
+        self.assertRaises(EOFError, _read_frame, stream, 100)
+        self.assertEqual(_read_frame(io.BytesIO(), 100), None)
+        self.assertRaises(ValueError, _read_frame, io.BytesIO(data), 10)
+        self.assertRaises(ValueError, _read_frame, io.BytesIO(b"\x00\x00\x00\x03\x01\x00\x00"), 10)
+
+    def test_remote_context(self):
+        """test RemoteCryptContext against ContextServer"""
+        server, path = self.start_server()
+        self.assertTrue(stat.S_ISSOCK(os.stat(path).st_mode))
+        self.assertEqual(stat.S_IMODE(os.stat(path).st_mode), 0o600)
+
+        with RemoteCryptContext(path) as remote:
+            # hash & verify, using unicode & bytes secrets
+            hash = remote.hash(u"t\xe1ste")
+            self.assertTrue(hash.startswith("$1$"))
+            self.assertTrue(self.context.verify(u"t\xe1ste", hash))
+            self.assertTrue(remote.verify(u"t\xe1ste".encode("utf-8"), hash))
+            self.assertTrue(remote.verify(u"t\xe1ste", hash.encode("ascii")))
+            self.assertFalse(remote.verify(u"wrong", hash))
+            self.assertFalse(remote.verify(u"wrong", None))
+
+            # categories, context kwds & verify_and_update
+            self.assertTrue(remote.hash("pw", category="admin").startswith("$5$"))
+            pg_hash = self.context.handler("postgres_md5").hash("pw", user="alice")
+            self.assertTrue(remote.verify("pw", pg_hash, user="alice"))
+            self.assertFalse(remote.verify("pw", pg_hash, user="bob"))
+            old_hash = self.context.handler("des_crypt").hash("pw")
+            self.assertEqual(remote.verify_and_update("pw", hash), (False, None))
+            valid, new_hash = remote.verify_and_update("pw", old_hash)
+            self.assertTrue(valid)
+            self.assertTrue(new_hash.startswith("$1$"))
+            self.assertTrue(remote.needs_update(old_hash))
+            self.assertFalse(remote.needs_update(hash))
+
+            # errors should be re-raised w/ same class
+            self.assertRaises(ValueError, remote.verify, "pw", "$x$abc")
+            self.assertRaises(PasswordSizeError, remote.hash, "x" * 5000)
+            self.assertRaises(TypeError, remote.hash, 123)
+            self.assertRaises(TypeError, remote.verify, "pw", hash, scheme="md5_crypt")
+
+            # only context kwds should be accepted, not settings
+            self.assertRaises(TypeError, remote.hash, "pw", rounds="1000")
+            self.assertRaises(TypeError, remote.hash, "pw", salt="abcdefgh")
+            self.assertRaises(TypeError, remote.verify, "pw", hash, relaxed="1")
+
+            # stats
+            stats = remote.stats()
+            self.assertEqual(stats["workers"], 2)
+            self.assertEqual(stats["ops"]["hash"]["count"], 5)
+            self.assertEqual(stats["ops"]["hash"]["errors"], 3)
+            self.assertEqual(stats["ops"]["verify"]["errors"], 3)
+            self.assertEqual(stats["connections"], 1)
+            self.assertEqual(server.stats()["ops"], stats["ops"])
+
+            # concurrent use
+            results = []
+            def worker():
+                results.append(remote.verify(u"t\xe1ste", hash))
+            threads = [threading.Thread(target=worker) for _ in range(8)]
+            for thread in threads:
+                thread.start()
+            for thread in threads:
+                thread.join()
+            self.assertEqual(results, [True] * 8)
+            self.assertLessEqual(len(remote._pool), remote.pool_size)
+
+        # oversized response should be rejected by client
+        with RemoteCryptContext(path, max_response_size=20) as remote:
+            self.assertRaises(ValueError, remote.hash, "pw")
+            self.assertEqual(remote._pool, [])
+            self.assertTrue(remote.verify(u"t\xe1ste", hash))
+
+        # oversized request should cause connection to be closed
+        sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        try:
+            sock.connect(path)
+            sock.sendall(b"\x7f\x00\x00\x00")
+            self.assertEqual(sock.recv(10), b"")
+        finally:
+            sock.close()
+
+    def test_connection_limits(self):
+        """test max_connections & timeout"""
+        import time
+        server, path = self.start_server(max_connections=1, timeout=0.2)
+
+        # connections over the limit should be closed immediately
+        idle = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        self.addCleanup(idle.close)
+        idle.connect(path)
+        for _ in range(50):
+            if server.stats()["connections"]:
+                break
+            time.sleep(0.01)
+        remote = RemoteCryptContext(path)
+        self.addCleanup(remote.close)
+        self.assertRaises(socket.error, remote.hash, "pw")
+        self.assertEqual(server.stats()["rejected_connections"], 1)
+
+        # idle connection should be closed after timeout, freeing up its slot
+        idle.settimeout(5)
+        self.assertEqual(idle.recv(10), b"")
+        hash = remote.hash("pw")
+
+        # client should reconnect if server closed its pooled connection
+        time.sleep(0.4)
+        self.assertTrue(remote.verify("pw", hash))
+        self.assertEqual(server.stats()["total_connections"], 3)
+
+    def test_server_restart(self):
+        """test client reconnects after server restarts, and stale socket handling"""
+        server, path = self.start_server()
+        remote = RemoteCryptContext(path)
+        self.addCleanup(remote.close)
+        hash = remote.hash("pw")
+
+        # running server shouldn't be replaced
+        self.assertRaises(RuntimeError, ContextServer, self.context, path, warmup=False)
+
+        # pooled connection is stale after restart, client should retry on new connection
+        server.shutdown()
+        self.assertFalse(os.path.exists(path))
+        self.assertRaises(socket.error, RemoteCryptContext(path).hash, "pw")
+        server2 = ContextServer(self.context, path, warmup=False)
+        self.addCleanup(server2.shutdown)
+        thread = threading.Thread(target=server2.serve_forever)
+        thread.daemon = True
+        thread.start()
+        self.assertTrue(remote.verify("pw", hash))
+
+        # stale socket file should be replaced, other files shouldn't
+        path2 = self.mktemp()
+        self.assertRaises(RuntimeError, ContextServer, self.context, path2, warmup=False)
+        os.remove(path2)
+        sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        sock.bind(path2)
+        sock.close()
+        server3 = ContextServer(self.context, path2, warmup=False, mode=0o660)
+        self.assertEqual(stat.S_IMODE(os.stat(path2).st_mode), 0o660)
+        server3.shutdown()
+        self.assertFalse(os.path.exists(path2))
+
+#=============================================================================
+# eof
+#=============================================================================
@@ -5,6 +5,7 @@
 from __future__ import with_statement
 # core
 from functools import partial
+import os
 import warnings
 # site
 # pkg
@@ -85,6 +86,37 @@ class MiscTest(TestCase):
         if not PY3:
             self.assertIs(prop.im_func, prop.__func__)
 
+    def test_memoized_class_property(self):
+        from passlib.utils.decor import memoized_class_property
+
+        class dummy(object):
+            calls = []
+            name = "a"
+
+            @memoized_class_property
+            def value(cls):
+                cls.calls.append(cls)
+                return cls.name * 2
+
+        class child(dummy):
+            name = "b"
+
+        # value should be computed once per class it's accessed through
+        self.assertEqual(child().value, "bb")
+        self.assertEqual(child.value, "bb")
+        self.assertEqual(dummy.value, "aa")
+        self.assertEqual(dummy().value, "aa")
+        self.assertEqual(dummy.calls, [child, dummy])
+        self.assertEqual(child.__dict__['value'], "bb")
+
+        # descriptors returned by func should be bound normally, even on first access
+        class holder(object):
+            @memoized_class_property
+            def func(cls):
+                return staticmethod(len)
+        self.assertEqual(holder().func("abc"), 3)
+        self.assertEqual(holder().func("ab"), 2)
+
     def test_getrandbytes(self):
         """getrandbytes()"""
         from passlib.utils import getrandbytes
@@ -201,6 +233,7 @@ class MiscTest(TestCase):
 
         # test rejects null chars in password
         self.assertRaises(ValueError, safe_crypt, '\x00', 'aa')
+        self.assertRaises(ValueError, safe_crypt, b'\x00', 'aa')
 
         # check test_crypt()
         h1x = h1[:-1] + 'x'
@@ -413,6 +446,114 @@ class MiscTest(TestCase):
         self.assertEqual(splitcomma(" a , b"), ['a', 'b'])
         self.assertEqual(splitcomma(" a, b, "), ['a', 'b'])
 
+    def test_imap_ordered(self):
+        from passlib.utils import imap_ordered
+        import time
+
+        # results should be in order, even if workers finish out of order
+        def func(value):
+            time.sleep(0.001 * (value % 3))
+            return value * 2
+        self.assertEqual(list(imap_ordered(func, range(20), workers=4)),
+                         [v * 2 for v in range(20)])
+
+        # source should only be read ahead by max_pending elements
+        consumed = []
+        def source():
+            for value in range(100):
+                consumed.append(value)
+                yield value
+        result = imap_ordered(func, source(), workers=2, max_pending=3)
+        self.assertEqual(next(result), 0)
+        self.assertLessEqual(len(consumed), 5)
+        result.close()
+
+        # errors should be propagated
+        def bad(value):
+            raise ValueError("bad")
+        self.assertRaises(ValueError, list, imap_ordered(bad, [1], workers=1))
+        self.assertRaises(ValueError, list, imap_ordered(func, [1], max_pending=0))
+
+    def test_rank_fastest(self):
+        import passlib.utils as mod
+        from passlib.utils import rank_fastest
+        import time
+
+        path = self.mktemp()
+        os.remove(path)
+        key = "PASSLIB_RANKING_CACHE"
+        orig = os.environ.get(key)
+        if orig is None:
+            self.addCleanup(os.environ.__delitem__, key)
+        else:
+            self.addCleanup(os.environ.__setitem__, key, orig)
+        self.patchAttr(mod, "_ranking_cache", {})
+
+        # shouldn't write to disk by default
+        os.environ.pop(key, None)
+        self.assertIs(mod._get_ranking_path(), None)
+        os.environ[key] = path
+
+        # should rank by speed, omitting candidates with wrong output
+        delays = dict(slow=0.002, fast=0, wrong=0)
+        prepared = []
+        def prepare(name):
+            prepared.append(name)
+            def func():
+                time.sleep(delays[name])
+                return "ok" if name != "wrong" else "bad"
+            return func
+        self.assertEqual(rank_fastest("test", ["slow", "fast", "wrong"], prepare, min_time=0.005),
+                         ["fast", "slow"])
+        self.assertEqual(prepared, ["slow", "fast", "wrong"])
+        self.assertTrue(os.path.exists(path))
+
+        # result should be cached in-process & on disk
+        del prepared[:]
+        self.assertEqual(rank_fastest("test", ["slow", "fast", "wrong"], prepare), ["fast", "slow"])
+        self.assertEqual(prepared, [])
+        mod._ranking_cache.clear()
+        self.assertEqual(rank_fastest("test", ["slow", "fast", "wrong"], prepare), ["fast", "slow"])
+        # (on-disk winner is re-checked against reference, but not benchmarked)
+        self.assertEqual(prepared, ["slow", "fast"])
+        del prepared[:]
+
+        # changing candidates should trigger new benchmark
+        self.assertEqual(rank_fastest("test", ["fast", "slow"], prepare, min_time=0.005),
+                         ["fast", "slow"])
+        self.assertEqual(prepared, ["fast", "slow"])
+
+        # candidates which raise errors (when prepared or run) should be skipped,
+        # and reference output taken from first one that works
+        def prepare_broken(name):
+            if name == "noload":
+                raise ImportError("missing")
+            func = prepare(name)
+            if name == "slow":
+                state = []
+                def func():
+                    if state:
+                        raise RuntimeError("flaky")
+                    state.append(1)
+                    return "ok"
+            return func
+        self.assertEqual(rank_fastest("test2", ["noload", "slow", "fast", "wrong"], prepare_broken,
+                                      min_time=0.005), ["fast"])
+
+        # tampered / stale ranking on disk should be re-validated, and discarded if wrong
+        mod._ranking_cache.clear()
+        mod._save_ranking(path, "test3", ["fast", "wrong"], ["wrong", "fast"])
+        del prepared[:]
+        self.assertEqual(rank_fastest("test3", ["fast", "wrong"], prepare, min_time=0.005),
+                         ["fast"])
+        self.assertEqual(prepared, ["fast", "wrong", "fast", "wrong"])
+
+        # ... but used if winner output still matches
+        mod._ranking_cache.clear()
+        del prepared[:]
+        self.assertEqual(rank_fastest("test3", ["fast", "wrong"], prepare), ["fast"])
+        self.assertEqual(prepared, ["fast"])
+
 #=============================================================================
 # byte/unicode helpers
 #=============================================================================
@@ -89,9 +89,151 @@ class SkeletonTest(TestCase):
         self.assertEqual(d1.hash('s'), '_a')
         self.assertEqual(d1.hash('s', flag=True), '_b')
 
+    def test_01_static_handler_fast_path(self):
+        """test StaticHandler._calc_static_checksum() fast path"""
+
+        class d1(uh.StaticHandler):
+            name = "d1"
+            context_kwds = ("flag",)
+            _hash_prefix = u"_"
+            checksum_chars = u"ab"
+            checksum_size = 1
+
+            def __init__(self, flag=False, **kwds):
+                super(d1, self).__init__(**kwds)
+                self.flag = flag
+
+            @classmethod
+            def _calc_static_checksum(cls, secret, flag=False):
+                return u'b' if flag else u'a'
+
+        # hash() should still route through instance
+        self.assertEqual(d1.hash('s'), '_a')
+        self.assertEqual(d1.hash('s', flag=True), '_b')
+
+        # check verify method
+        self.assertTrue(d1.verify('s', b'_a'))
+        self.assertFalse(d1.verify('s', u'_b'))
+        self.assertTrue(d1.verify('s', b'_b', flag=True))
+        self.assertRaises(ValueError, d1.verify, 's', u'_c')
+        self.assertRaises(ValueError, d1.verify, 's', u'a')
+        self.assertRaises(TypeError, d1.verify, None, u'_a')
+
+        # check verify_many method
+        self.assertEqual(d1.verify_many([('s', u'_a'), ('s', b'_b')]), [True, False])
+        self.assertEqual(d1.verify_many([('s', u'_a')], flag=True), [False])
+        self.assertRaises(ValueError, d1.verify_many, [('s', u'_a'), ('s', u'_c')])
+
+        # subclass overriding _calc_checksum() shouldn't use fast path
+        class d2(d1):
+            def _calc_checksum(self, secret):
+                return u'b'
+
+        self.assertEqual(d2.hash('s'), '_b')
+        self.assertTrue(d2.verify('s', u'_b'))
+        self.assertFalse(d2.verify('s', u'_a'))
+        self.assertEqual(d2.verify_many([('s', u'_a'), ('s', u'_b')]), [False, True])
+        self.assertTrue(d1.verify('s', u'_a'))
+
     #===================================================================
     # GenericHandler & mixins
     #===================================================================
+    def test_02_validate_secret(self):
+        """test validate_secret() normalization"""
+        from passlib.exc import PasswordSizeError
+        from passlib.utils import MAX_PASSWORD_SIZE
+
+        # unicode & bytes returned as-is
+        secret = u"t\xe1ste"
+        self.assertIs(uh.validate_secret(secret), secret)
+        secret = b"test"
+        self.assertIs(uh.validate_secret(secret), secret)
+
+        # buffers converted to bytes
+        self.assertEqual(uh.validate_secret(bytearray(b"test")), b"test")
+        self.assertIsInstance(uh.validate_secret(bytearray(b"test")), bytes)
+        self.assertEqual(uh.validate_secret(memoryview(b"xtest")[1:]), b"test")
+        self.assertIsInstance(uh.validate_secret(memoryview(b"test")), bytes)
+
+        # other types & oversized secrets rejected
+        self.assertRaises(TypeError, uh.validate_secret, None)
+        self.assertRaises(TypeError, uh.validate_secret, 1)
+        self.assertRaises(PasswordSizeError, uh.validate_secret, b"x" * (MAX_PASSWORD_SIZE + 1))
+        self.assertRaises(PasswordSizeError, uh.validate_secret,
+                          bytearray(MAX_PASSWORD_SIZE + 1))
+
+        # handlers should see converted secret
+        class d1(uh.GenericHandler):
+            name = "d1"
+            setting_kwds = ()
+            checksum_chars = u"ab"
+
+            @classmethod
+            def from_string(cls, hash):
+                return cls(checksum=hash)
+
+            def to_string(self):
+                return self.checksum
+
+            def _calc_checksum(self, secret):
+                assert isinstance(secret, bytes)
+                return u"a" if secret == b"test" else u"b"
+
+        self.assertEqual(d1.hash(bytearray(b"test")), u"a")
+        self.assertTrue(d1.verify(memoryview(b"test"), u"a"))
+        self.assertFalse(d1.verify(bytearray(b"wrong"), u"a"))
+
+    def test_05_compile(self):
+        """test GenericHandler._compile() & mixins"""
+        from passlib.hash import sha256_crypt, bcrypt, ldap_salted_md5
+
+        # compiled salt & rounds validators should match generic behavior
+        handler = sha256_crypt.using(rounds=5000)._compile()
+        self.assertTrue(handler._compiled)
+        self.assertEqual(handler._norm_rounds(5000), 5000)
+        self.assertRaises(ValueError, handler._norm_rounds, 999)
+        with self.assertWarningList([PasslibHashWarning]):
+            self.assertEqual(handler._norm_rounds(999, relaxed=True), 1000)
+        self.assertRaises(TypeError, handler._norm_rounds, "5000")
+        self.assertEqual(handler._generate_rounds(), 5000)
+        self.assertEqual(handler._norm_salt(u"abcd"), u"abcd")
+        self.assertRaises(ValueError, handler._norm_salt, u"ab*d")
+        self.assertRaises(TypeError, handler._norm_salt, 1)
+        self.assertEqual(len(handler._generate_salt()), sha256_crypt.default_salt_size)
+        self.assertRaises(ValueError, handler, checksum=u"x" * 42)
+        self.assertRaises(ValueError, handler, checksum=u"*" * 43)
+
+        # should leave vary_rounds alone
+        with warnings.catch_warnings():
+            warnings.simplefilter("ignore", uh.exc.PasslibConfigWarning)
+            handler = sha256_crypt.using(rounds=5000, vary_rounds=100)._compile()
+        self.assertEqual(handler._generate_rounds.__name__, "_generate_rounds")
+
+        # compiled ident lookup should match generic behavior
+        handler = bcrypt.using(ident="2b")._compile()
+        self.assertEqual(handler.default_ident, u"$2b$")
+        self.assertEqual(handler._norm_ident(u"2y"), u"$2y$")
+        self.assertEqual(handler._norm_ident(b"$2a$"), u"$2a$")
+        self.assertRaises(ValueError, handler._norm_ident, u"$2c$")
+
+        # raw salt
+        handler = ldap_salted_md5.using(salt_size=8)._compile()
+        self.assertEqual(len(handler._generate_salt()), 8)
+        self.assertRaises(ValueError, handler._norm_salt, b"abc")
+        self.assertRaises(TypeError, handler._norm_salt, u"abcd")
+
+        # using() on compiled record shouldn't inherit its pre-resolved settings
+        from passlib.context import CryptContext
+        ctx = CryptContext(["sha256_crypt", "ldap_salted_sha1"], compile=True,
+                           sha256_crypt__default_rounds=5000)
+        handler = ctx.handler("sha256_crypt").using(rounds=9000)
+        self.assertFalse(handler._compiled)
+        self.assertEqual(handler.default_rounds, 9000)
+        self.assertEqual(handler.from_string(handler.hash("test")).rounds, 9000)
+        self.assertTrue(handler._compile().hash("test").startswith("$5$rounds=9000$"))
+        handler = ctx.handler("ldap_salted_sha1").using(salt_size=16)
+        self.assertEqual(len(handler.from_string(handler.hash("test")).salt), 16)
+
     def test_10_identify(self):
         """test GenericHandler.identify()"""
         class d1(uh.GenericHandler):
@@ -432,6 +574,207 @@ class SkeletonTest(TestCase):
         self.assertRaises(ValueError, d1.set_backend, 'c')
         self.assertRaises(ValueError, d1.has_backend, 'c')
 
+    def test_42_backends_fastest(self):
+        """test HasManyBackends.set_backend('fastest')"""
+        import os
+        import time
+        import passlib.utils as utils_mod
+
+        key = "PASSLIB_RANKING_CACHE"
+        orig = os.environ.get(key)
+        if orig is None:
+            self.addCleanup(os.environ.__delitem__, key)
+        else:
+            self.addCleanup(os.environ.__setitem__, key, orig)
+        os.environ[key] = ""
+        self.patchAttr(utils_mod, "_ranking_cache", {})
+
+        class d1(uh.HasManyBackends, uh.GenericHandler):
+            name = 'd1_fastest'
+            setting_kwds = ()
+            backends = ("a", "b", "c")
+
+            @classmethod
+            def _load_backend_a(cls):
+                cls._set_calc_checksum_backend(cls._calc_checksum_a)
+                return True
+
+            @classmethod
+            def _load_backend_b(cls):
+                cls._set_calc_checksum_backend(cls._calc_checksum_b)
+                return True
+
+            @classmethod
+            def _load_backend_c(cls):
+                cls._set_calc_checksum_backend(cls._calc_checksum_c)
+                return True
+
+            def _calc_checksum_a(self, secret):
+                time.sleep(0.002)
+                return u'x'
+
+            def _calc_checksum_b(self, secret):
+                return u'x'
+
+            def _calc_checksum_c(self, secret):
+                # faster, but gives wrong answer -- shouldn't be selected
+                return u'y'
+
+        # dry run should act like 'default'
+        self.assertTrue(d1.has_backend("fastest"))
+        self.assertEqual(utils_mod._ranking_cache, {})
+
+        # should pick fastest backend which matches reference output
+        self.assertEqual(d1.set_backend("fastest"), "b")
+        self.assertEqual(d1.get_backend(), "b")
+        self.assertEqual(utils_mod._ranking_cache["backend:d1_fastest"][1], ["b", "a"])
+
+        # backends which raise errors should be skipped
+        class d2(d1):
+            name = 'd2_fastest'
+
+            def _calc_checksum_b(self, secret):
+                raise RuntimeError("broken backend")
+
+        self.assertEqual(d2.set_backend("fastest"), "a")
+        self.assertEqual(d2.get_backend(), "a")
+
+        # SubclassBackendMixin should benchmark each backend mixin's _calc_checksum()
+        class d4_common(uh.SubclassBackendMixin, uh.GenericHandler):
+            name = 'd4_fastest'
+            setting_kwds = ()
+            backends = ("a", "b")
+
+        class d4_backend_a(d4_common):
+            @classmethod
+            def _load_backend_mixin(mixin_cls, name, dryrun):
+                return True
+
+            def _calc_checksum(self, secret):
+                time.sleep(0.002)
+                return u'x'
+
+        class d4_backend_b(d4_common):
+            @classmethod
+            def _load_backend_mixin(mixin_cls, name, dryrun):
+                return True
+
+            def _calc_checksum(self, secret):
+                return u'x'
+
+        class d4(d4_common):
+            _backend_mixin_target = True
+            _backend_mixin_map = dict(a=d4_backend_a, b=d4_backend_b)
+
+        self.assertIsNotNone(d4._get_backend_benchmark())
+        self.assertEqual(d4.set_backend("fastest"), "b")
+        self.assertEqual(d4.get_backend(), "b")
+        self.assertEqual(d4()._calc_checksum("s"), u'x')
+        self.assertEqual(utils_mod._ranking_cache["backend:d4_fastest"][1], ["b", "a"])
+
+        # if ranking fails, original backend should be restored
+        class d3(d1):
+            name = 'd3_fastest'
+
+        d3.set_backend("c")
+        def bad_rank(*args, **kwds):
+            d3.set_backend("b")
+            raise KeyboardInterrupt()
+        self.patchAttr(uh, "rank_fastest", bad_rank)
+        self.assertRaises(KeyboardInterrupt, d3.set_backend, "fastest")
+        self.assertEqual(d3.get_backend(), "c")
+
+    def test_43_backends_pinned(self):
+        """test using(backend=...) doesn't modify original class"""
+        from passlib.context import CryptContext
+
+        #
+        # HasManyBackends
+        #
+        class d1(uh.HasManyBackends, uh.GenericHandler):
+            name = 'd1_pinned'
+            setting_kwds = ()
+            backends = ("a", "b")
+
+            @classmethod
+            def _load_backend_a(cls):
+                cls._set_calc_checksum_backend(cls._calc_checksum_a)
+                return True
+
+            @classmethod
+            def _load_backend_b(cls):
+                cls._set_calc_checksum_backend(cls._calc_checksum_b)
+                return True
+
+            def _calc_checksum_a(self, secret):
+                return u'a'
+
+            def _calc_checksum_b(self, secret):
+                return u'b'
+
+        d1.set_backend("a")
+        p1 = d1.using(backend="b")
+        self.assertEqual(p1.get_backend(), "b")
+        self.assertEqual(d1.get_backend(), "a")
+        self.assertEqual(p1()._calc_checksum("s"), "b")
+
+        # pinning current backend should still be immune to later global changes
+        p2 = d1.using(backend="a")
+        d1.set_backend("b")
+        self.assertEqual(p1.get_backend(), "b")
+        self.assertEqual(p2.get_backend(), "a")
+        self.assertEqual(p2()._calc_checksum("s"), "a")
+
+        self.assertRaises(ValueError, d1.using, backend="c")
+
+        # should be usable via CryptContext
+        ctx = CryptContext([d1], d1_pinned__backend="a")
+        self.assertEqual(ctx.handler().get_backend(), "a")
+        self.assertEqual(ctx.handler()()._calc_checksum("s"), "a")
+        self.assertEqual(d1.get_backend(), "b")
+
+        #
+        # SubclassBackendMixin
+        #
+        class d2_common(uh.SubclassBackendMixin, uh.GenericHandler):
+            name = 'd2_pinned'
+            setting_kwds = ()
+            backends = ("a", "b")
+
+        class d2_backend_a(d2_common):
+            @classmethod
+            def _load_backend_mixin(mixin_cls, name, dryrun):
+                return True
+
+            def _calc_checksum(self, secret):
+                return u'a'
+
+        class d2_backend_b(d2_common):
+            @classmethod
+            def _load_backend_mixin(mixin_cls, name, dryrun):
+                return True
+
+            def _calc_checksum(self, secret):
+                return u'b'
+
+        class d2(d2_common):
+            _backend_mixin_target = True
+            _backend_mixin_map = dict(a=d2_backend_a, b=d2_backend_b)
+
+        d2.set_backend("a")
+        p3 = d2.using(backend="b")
+        self.assertEqual(p3.get_backend(), "b")
+        self.assertEqual(d2.get_backend(), "a")
+        self.assertEqual(d2()._calc_checksum("s"), "a")
+        self.assertEqual(p3()._calc_checksum("s"), "b")
+
+        d2.set_backend("b")
+        p4 = d2.using(backend="default")
+        d2.set_backend("a")
+        self.assertEqual(p4.get_backend(), "a")
+        self.assertEqual(p3()._calc_checksum("s"), "b")
+        self.assertEqual(p3.using()()._calc_checksum("s"), "b")
+
     def test_50_norm_ident(self):
         """test GenericHandler + HasManyIdents"""
         # setup helpers
@@ -474,6 +817,34 @@ class SkeletonTest(TestCase):
         d1.default_ident = None
         self.assertRaises(AssertionError, norm_ident, use_defaults=True)
 
+    def test_60_class_defaults(self):
+        """test instance attrs have assignable class-level defaults"""
+        from passlib.hash import md5_crypt, phpass, pbkdf2_sha256
+
+        # should read as None from the class
+        self.assertIs(md5_crypt.checksum, None)
+        self.assertIs(md5_crypt.salt, None)
+        self.assertIs(pbkdf2_sha256.rounds, None)
+        self.assertIs(phpass.ident, None)
+
+        # subclasses should be able to assign them, without affecting instances
+        class d1(uh.HasRounds, uh.HasSalt, uh.GenericHandler):
+            name = "d1"
+            setting_kwds = ("salt", "rounds")
+            min_salt_size = max_salt_size = 2
+            default_rounds = 1
+            max_rounds = 10
+
+        d1.salt = u"zz"
+        d1.rounds = 5
+        self.assertEqual((d1.salt, d1.rounds), (u"zz", 5))
+        obj = d1(salt=u"ab", rounds=3)
+        self.assertEqual((obj.salt, obj.rounds, obj.checksum), (u"ab", 3, None))
+        d1.checksum = u"x"
+        self.assertEqual(d1.checksum, u"x")
+        del d1.checksum
+        self.assertIs(d1.checksum, None)
+
     #===================================================================
     # experimental - the following methods are not finished or tested,
     # but way work correctly for some hashes
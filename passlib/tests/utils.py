@@ -2213,6 +2213,27 @@ class HandlerCase(TestCase):
         self.assertRaises(TypeError, self.do_genhash, 1, hash)
         self.assertRaises(TypeError, self.do_verify, 1, hash)
 
+    def test_62b_buffer_secrets(self):
+        """test bytearray & memoryview passwords are treated same as bytes"""
+        handler = self.handler
+        secret = b"test"
+        hash = self.do_encrypt(secret)
+        expected = self.do_verify(secret, hash)
+        for wrap in (bytearray, memoryview):
+            buf = wrap(secret)
+            self.assertEqual(self.do_verify(buf, hash), expected,
+                             "verify() failed for %s secret" % wrap.__name__)
+            self.assertEqual(self.do_verify(secret, self.do_encrypt(buf)), expected,
+                             "hash() failed for %s secret" % wrap.__name__)
+            if not handler.is_disabled:
+                self.assertEqual(self.do_genhash(buf, hash), self.do_genhash(secret, hash),
+                                 "genhash() failed for %s secret" % wrap.__name__)
+            if hasattr(handler, "verify_many"):
+                kwds = {}
+                self.populate_context(buf, kwds)
+                self.assertEqual(handler.verify_many([(buf, hash)], **kwds), [expected],
+                                 "verify_many() failed for %s secret" % wrap.__name__)
+
     # xxx: move to password size limits section, above?
     def test_63_large_secret(self):
         """test MAX_PASSWORD_SIZE is enforced"""
@@ -2300,6 +2321,55 @@ class HandlerCase(TestCase):
         if not saw8bit:
             warn("%s: no 8-bit secrets tested" % self.__class__)
 
+    def test_70b_verify_many(self):
+        """test verify_many() against known hashes"""
+        handler = self.handler
+        verify_many = getattr(handler, "verify_many", None)
+        if verify_many is None:
+            raise self.skipTest("handler doesn't provide verify_many()")
+        if getattr(verify_many, "__func__", None) is uh.GenericHandler.verify_many.__func__ and \
+                not getattr(handler, "_salted_digest", None):
+            # default implementation just loops over verify(), which test_70 already covers
+            raise self.skipTest("handler uses default verify_many()")
+        for secret, hash in self.iter_known_hashes():
+            if self.expect_os_crypt_failure(secret):
+                continue
+            kwds = {}
+            secret = self.populate_context(secret, kwds)
+            other = secret + (b"x" if isinstance(secret, bytes) else u"x")
+            expected = [handler.verify(secret, hash, **kwds),
+                        handler.verify(other, hash, **kwds)]
+            result = handler.verify_many([(secret, hash), (other, hash)], **kwds)
+            self.assertEqual(result, expected, "verify_many() failed: "
+                             "secret=%r, hash=%r" % (secret, hash))
+
+        # malformed hashes should be rejected, same as verify()
+        kwds = {}
+        secret = self.populate_context(self.stock_passwords[0], kwds)
+        for hash in self.known_malformed_hashes:
+            self.assertRaises(ValueError, handler.verify_many, [(secret, hash)],
+                              __msg__="hash=%r:" % (hash,), **kwds)
+
+        # case-altered variants of known hashes should be accepted or rejected
+        # exactly as verify() does
+        def outcome(func, *args):
+            try:
+                return func(*args, **kwds)
+            except ValueError:
+                return ValueError
+        for secret, hash in self.iter_known_hashes():
+            if self.expect_os_crypt_failure(secret):
+                continue
+            kwds = {}
+            secret = self.populate_context(secret, kwds)
+            for alt in set([hash.lower(), hash.upper(), hash.swapcase()]):
+                expected = outcome(handler.verify, secret, alt)
+                result = outcome(handler.verify_many, [(secret, alt)])
+                if result is not ValueError:
+                    result = result[0]
+                self.assertEqual(result, expected, "verify_many() disagrees with verify(): "
+                                 "secret=%r, hash=%r" % (secret, alt))
+
     def test_71_alternates(self):
         """test known alternate hashes"""
         if not self.known_alternate_hashes:
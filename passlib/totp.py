@@ -623,9 +623,10 @@ class TOTP(object):
     #: so .to_json() doesn't have to re-encrypt on each call.
     _encrypted_key = None
 
-    #: [private] cached copy of keyed HMAC function,
+    #: [private] cached ``(key, keyed HMAC function)`` tuple,
     #: so ._generate() doesn't have to rebuild this each time
-    #: ._find_match() invokes it.
+    #: ._find_match() invokes it.  (key is stored alongside so a thread
+    #: racing with a key change can't leave behind a stale function).
     _keyed_hmac = None
 
     #: number of digits in the generated tokens.
@@ -1114,9 +1115,13 @@ class TOTP(object):
         # generate digest
         assert isinstance(counter, int_types), "counter must be integer"
         assert counter >= 0, "counter must be non-negative"
-        keyed_hmac = self._keyed_hmac
-        if keyed_hmac is None:
-            keyed_hmac = self._keyed_hmac = compile_hmac(self.alg, self.key)
+        key = self._key
+        cached = self._keyed_hmac
+        if cached is not None and cached[0] is key:
+            keyed_hmac = cached[1]
+        else:
+            keyed_hmac = compile_hmac(self.alg, key, cache=True)
+            self._keyed_hmac = (key, keyed_hmac)
         digest = keyed_hmac(_pack_uint64(counter))
         digest_size = keyed_hmac.digest_info.digest_size
         assert len(digest) == digest_size, "digest_size: sanity check failed"
@@ -82,6 +82,7 @@ __all__ = [
     'test_crypt',
     'safe_crypt',
     'tick',
+    'rank_fastest',
 
     # randomness
     'rng',
@@ -291,6 +292,58 @@ def batch(source, size):
     else:
         raise TypeError("source must be iterable")
 
+def cpu_count():
+    """
+    return number of cpus on host (or 1 if it can't be determined).
+    """
+    import multiprocessing
+    try:
+        return multiprocessing.cpu_count()
+    except NotImplementedError: # pragma: no cover -- runtime detection
+        return 1
+
+def imap_ordered(func, source, workers=None, max_pending=None, pool=None):
+    """
+    apply *func* to each element of iterable *source* in parallel,
+    yielding the results in the same order as *source*.
+
+    unlike :meth:`!multiprocessing.Pool.imap`, no more than *max_pending*
+    elements are read ahead of the consumer, so memory use stays bounded
+    for arbitrarily large sources.
+
+    :param workers:
+        number of worker threads to use (defaults to :func:`cpu_count`).
+
+    :param max_pending:
+        maximum number of elements to have in progress (defaults to ``4 * workers``).
+
+    :param pool:
+        optional :mod:`multiprocessing` pool (thread or process based) to use.
+        if omitted, a thread pool is created, and shut down when the iterator is exhausted or closed.
+    """
+    if workers is None:
+        workers = cpu_count()
+    if max_pending is None:
+        max_pending = 4 * workers
+    if max_pending < 1:
+        raise ValueError("max_pending must be >= 1")
+    own_pool = pool is None
+    if own_pool:
+        from multiprocessing.pool import ThreadPool
+        pool = ThreadPool(workers)
+    pending = collections.deque()
+    try:
+        for item in source:
+            if len(pending) >= max_pending:
+                yield pending.popleft().get()
+            pending.append(pool.apply_async(func, (item,)))
+        while pending:
+            yield pending.popleft().get()
+    finally:
+        if own_pool:
+            pool.terminate()
+            pool.join()
+
 #=============================================================================
 # unicode helpers
 #=============================================================================
@@ -752,6 +805,7 @@ except ImportError: # pragma: no cover
 else:
     has_crypt = True
     _NULL = '\x00'
+    _BNULL = b'\x00'
 
     # some crypt() variants will return various constant strings when
     # an invalid/unrecognized config string is passed in; instead of
@@ -766,14 +820,15 @@ else:
                 # Python 3's crypt() only accepts unicode, which is then
                 # encoding using utf-8 before passing to the C-level crypt().
                 # so we have to decode the secret.
-                orig = secret
+                # NOTE: checking for NULL before decoding, so each secret is only scanned once;
+                #       and not re-encoding to check round trip, since utf-8 guarantees it.
+                if _BNULL in secret:
+                    raise ValueError("null character in secret")
                 try:
                     secret = secret.decode("utf-8")
                 except UnicodeDecodeError:
                     return None
-                assert secret.encode("utf-8") == orig, \
-                            "utf-8 spec says this can't happen!"
-            if _NULL in secret:
+            elif _NULL in secret:
                 raise ValueError("null character in secret")
             if isinstance(hash, bytes):
                 hash = hash.decode("ascii")
@@ -847,6 +902,167 @@ else:
 # legacy alias, will be removed in passlib 2.0
 tick = timer
 
+#: in-process cache used by rank_fastest(), maps key -> (candidates, ranking)
+_ranking_cache = {}
+
+def _get_ranking_path():
+    """
+    return path of file used to persist rank_fastest() results,
+    or ``None`` if ``PASSLIB_RANKING_CACHE`` isn't set (the default).
+    """
+    return os.environ.get("PASSLIB_RANKING_CACHE") or None
+
+def _get_ranking_host():
+    """return string identifying host, interpreter & passlib version rankings are valid for"""
+    import platform
+    from passlib import __version__
+    return "%s %s-%s %s passlib-%s" % (platform.node(), platform.python_implementation(),
+                                       platform.python_version(), platform.machine(), __version__)
+
+def _load_rankings(path):
+    """load rankings for current host from file (returns empty dict on error)"""
+    import json
+    try:
+        with open(path) as fh:
+            data = json.load(fh)
+        return dict(data.get(_get_ranking_host()) or {})
+    except (IOError, OSError, ValueError, AttributeError):
+        return {}
+
+def _save_ranking(path, key, candidates, ranking):
+    """merge ranking into file; errors are logged and ignored (e.g. read-only home dir)"""
+    import json
+    try:
+        try:
+            with open(path) as fh:
+                data = json.load(fh)
+            if not isinstance(data, dict):
+                data = {}
+        except (IOError, OSError, ValueError):
+            data = {}
+        host = _get_ranking_host()
+        entries = data.get(host)
+        if not isinstance(entries, dict):
+            entries = data[host] = {}
+        entries[key] = dict(candidates=candidates, ranking=ranking)
+        dirname = os.path.dirname(path)
+        if dirname and not os.path.isdir(dirname):
+            os.makedirs(dirname)
+        tmp = "%s.%d.tmp" % (path, os.getpid())
+        with open(tmp, "w") as fh:
+            json.dump(data, fh, indent=1, sort_keys=True)
+        getattr(os, "replace", os.rename)(tmp, path)
+    except (IOError, OSError) as err:
+        log.debug("couldn't save ranking to %r: %s", path, err)
+
+def _prepare_candidate(key, name, prepare):
+    """helper for rank_fastest() -- returns ``(func, output)``, or ``None`` if candidate raised an error"""
+    try:
+        func = prepare(name)
+        return func, func()
+    except Exception as err:
+        log.warning("rank_fastest(%r): %r raised an error, ignoring it: %s", key, name, err)
+        return None
+
+def _check_cached_winner(key, candidates, winner, prepare):
+    """helper for rank_fastest() -- check persisted winner still matches reference output"""
+    for name in candidates:
+        reference = _prepare_candidate(key, name, prepare)
+        if reference is not None:
+            break
+    else:
+        return False
+    if name == winner:
+        return True
+    result = _prepare_candidate(key, winner, prepare)
+    return result is not None and result[1] == reference[1]
+
+def rank_fastest(key, candidates, prepare, min_time=0.02):
+    """
+    Rank interchangeable implementations by speed on the current host.
+
+    Each candidate is benchmarked in turn, and must produce the same output
+    as the first candidate which runs successfully; ones that don't, or which raise an error,
+    are logged & omitted from the ranking.
+    Results are cached in-process.  If the ``PASSLIB_RANKING_CACHE`` environment variable
+    is set, they're also persisted per host (keyed by hostname, interpreter, and passlib version)
+    to the file it names.
+    Before a persisted ranking is used, its winner's output is checked against the reference again.
+
+    :arg key:
+        string identifying the choice being made (e.g. ``"backend:bcrypt"``).
+
+    :arg candidates:
+        list of candidate names. If this differs from the cached entry,
+        the candidates are benchmarked again.
+
+    :arg prepare:
+        callable invoked as ``prepare(name)``, returning a zero-argument callable
+        which runs the candidate once and returns its output.
+        Candidates are prepared & benchmarked one at a time, in order.
+
+    :param min_time:
+        minimum number of seconds to spend timing each candidate.
+
+    :returns:
+        list of candidate names, fastest first.
+
+    .. versionadded:: 1.8
+    """
+    candidates = list(candidates)
+    cached = _ranking_cache.get(key)
+    if cached and cached[0] == candidates:
+        return list(cached[1])
+    path = _get_ranking_path()
+    if path:
+        entry = _load_rankings(path).get(key)
+        if entry and entry.get("candidates") == candidates:
+            ranking = [name for name in entry.get("ranking") or () if name in candidates]
+            # NOTE: file may be stale (or have been modified), so not trusting it
+            #       unless winner still produces the reference output.
+            if ranking and _check_cached_winner(key, candidates, ranking[0], prepare):
+                _ranking_cache[key] = (candidates, ranking)
+                return list(ranking)
+            log.warning("rank_fastest(%r): ignoring invalid cached ranking", key)
+
+    # benchmark candidates
+    timings = []
+    reference_name = None
+    for idx, name in enumerate(candidates):
+        prepared = _prepare_candidate(key, name, prepare)
+        if prepared is None:
+            continue
+        func, result = prepared
+        if reference_name is None:
+            reference_name = name
+            reference = result
+        elif result != reference:
+            log.warning("rank_fastest(%r): %r returned different output from %r, ignoring it",
+                        key, name, reference_name)
+            continue
+        count = 1
+        try:
+            while True:
+                start = timer()
+                for _ in irange(count):
+                    func()
+                elapsed = timer() - start
+                if elapsed >= min_time:
+                    break
+                count *= 2
+        except Exception as err:
+            log.warning("rank_fastest(%r): %r raised an error, ignoring it: %s", key, name, err)
+            continue
+        timings.append((elapsed / count, idx, name))
+    ranking = [name for _, _, name in sorted(timings)]
+    log.debug("rank_fastest(%r): %r", key, ranking)
+
+    # store results
+    _ranking_cache[key] = (candidates, ranking)
+    if path:
+        _save_ranking(path, key, candidates, ranking)
+    return list(ranking)
+
 def parse_version(source):
     """helper to parse version string"""
     m = re.search(r"(\d+(?:\.\d+)+)", source)
@@ -21,6 +21,7 @@ __all__ = [
 
     "memoize_single_value",
     "memoized_property",
+    "memoized_class_property",
 
     "deprecated_function",
     "deprecated_method",
@@ -79,8 +80,9 @@ def memoize_single_value(func):
             return cache[True]
         except KeyError:
             pass
-        value = cache[True] = func()
-        return value
+        # NOTE: using setdefault() so if threads race to populate the cache
+        #       (e.g. under free-threaded python), they all return the same value.
+        return cache.setdefault(True, func())
 
     def clear_cache():
         cache.pop(True, None)
@@ -100,9 +102,8 @@ class memoized_property(object):
     def __get__(self, obj, cls):
         if obj is None:
             return self
-        value = self.__func__(obj)
-        setattr(obj, self.__name__, value)
-        return value
+        # NOTE: setdefault() so racing threads all return the first value stored
+        return obj.__dict__.setdefault(self.__name__, self.__func__(obj))
 
     if not PY3:
 
@@ -127,23 +128,25 @@ class memoized_property(object):
         """
         return obj.__dict__.get(self.__name__, default)
 
-# works but not used
-##class memoized_class_property(object):
-##    """function decorator which calls function as classmethod,
-##    and replaces itself with result for current and all future invocations.
-##    """
-##    def __init__(self, func):
-##        self.im_func = func
-##
-##    def __get__(self, obj, cls):
-##        func = self.im_func
-##        value = func(cls)
-##        setattr(cls, func.__name__, value)
-##        return value
-##
-##    @property
-##    def __func__(self):
-##        "py3 compatible alias"
+class memoized_class_property(object):
+    """function decorator which calls function as classmethod,
+    and replaces itself with result for current and all future invocations.
+
+    the result is stored on the class it was accessed through, and is then inherited
+    by any of its subclasses which haven't computed their own value yet.
+    """
+    def __init__(self, func):
+        self.__func__ = func
+        self.__name__ = func.__name__
+        self.__doc__ = func.__doc__
+
+    def __get__(self, obj, cls):
+        # NOTE: if threads race, each may compute the value; last one stored wins,
+        #       so func should be cheap & deterministic.
+        setattr(cls, self.__name__, self.__func__(cls))
+        # NOTE: re-reading attr, so result is bound the same way as all later lookups
+        #       (e.g. if func returns a staticmethod).
+        return getattr(cls if obj is None else obj, self.__name__)
 
 #=============================================================================
 # deprecation
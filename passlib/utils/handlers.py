@@ -21,7 +21,7 @@ from passlib.utils import (
     rng, to_native_str,
     is_crypt_handler, to_unicode,
     MAX_PASSWORD_SIZE, accepts_keyword, as_bool,
-    update_mixin_classes)
+    update_mixin_classes, rank_fastest, timer)
 from passlib.utils.binary import (
     BASE64_CHARS, HASH64_CHARS, PADDED_BASE64_CHARS,
     HEX_CHARS, UPPER_HEX_CHARS, LOWER_HEX_CHARS,
@@ -29,7 +29,8 @@ from passlib.utils.binary import (
 )
 from passlib.utils.compat import join_byte_values, irange, native_string_types, \
                                  uascii_to_str, join_unicode, unicode, str_to_uascii, \
-                                 join_unicode, unicode_or_bytes_types, PY2, int_types
+                                 join_unicode, unicode_or_bytes_types, PY2, int_types, \
+                                 get_method_function, get_unbound_method_function
 from passlib.utils.decor import classproperty, deprecated_method
 # local
 __all__ = [
@@ -116,12 +117,28 @@ def extract_settings_kwds(handler, kwds):
 _UDOLLAR = u"$"
 _UZERO = u"0"
 
+#: buffer types accepted as secrets in addition to unicode & bytes
+_buffer_secret_types = (bytearray, memoryview)
+
 def validate_secret(secret):
-    """ensure secret has correct type & size"""
+    """
+    ensure secret has correct type & size, returning normalized secret.
+
+    unicode & bytes are returned as-is; :class:`!bytearray` & :class:`!memoryview`
+    are converted to bytes, so handlers only ever see unicode or bytes.
+    callers should pass the returned value along (rather than the original),
+    so the conversion only happens once per call.
+    """
     if not isinstance(secret, unicode_or_bytes_types):
-        raise exc.ExpectedStringError(secret, "secret")
+        if isinstance(secret, memoryview):
+            secret = secret.tobytes()
+        elif isinstance(secret, bytearray):
+            secret = bytes(secret)
+        else:
+            raise exc.ExpectedStringError(secret, "secret")
     if len(secret) > MAX_PASSWORD_SIZE:
         raise exc.PasswordSizeError(MAX_PASSWORD_SIZE)
+    return secret
 
 def to_unicode_for_identify(hash):
     """convert hash to unicode for identify method"""
@@ -328,6 +345,14 @@ def validate_default_value(handler, default, norm, param="value"):
     assert norm(default) == default, "%s: invalid default %s: %r" % (handler.name, param, default)
     return True
 
+def _is_inherited_from(cls, attr, owner):
+    """
+    helper for _compile() methods --
+    check that *cls* uses the implementation of method *attr* provided by *owner*,
+    rather than one overridden by a subclass.
+    """
+    return get_method_function(getattr(cls, attr)) is get_method_function(getattr(owner, attr))
+
 def norm_integer(handler, value, min=1, max=None, # *
                  param="value", relaxed=False):
     """
@@ -390,12 +415,40 @@ class MinimalHandler(PasswordHash):
         #       should wrap this, and modify the returned class to suit their options.
         # NOTE: 'relaxed' keyword is ignored here, but parsed so that subclasses
         #       can check for it as argument, and modify their parsing behavior accordingly.
+        # NOTE: compiled classes have their settings baked into their generators & validators,
+        #       so new settings are applied to the uncompiled class they were derived from.
+        while cls._compiled:
+            cls = cls.__bases__[0]
         name = cls.__name__
         if not cls._configured:
             # TODO: straighten out class naming, repr, and .name attr
             name = "<customized %s hasher>" % name
         return type(name, (cls,), dict(__module__=cls.__module__, _configured=True))
 
+    #===================================================================
+    # compiled variants
+    #===================================================================
+
+    #: private flag set on classes returned by _compile()
+    _compiled = False
+
+    @classmethod
+    def _compile(cls):
+        """
+        return a specialized subclass of this (already configured) handler,
+        for use by :class:`~passlib.context.CryptContext`'s ``compile`` option.
+
+        The subclass treats its current configuration as constant:
+        mixins wrap this method, and replace their generic validators & generators
+        with versions which have the class-level settings pre-resolved.
+        Changing the settings of the returned class afterwards is not supported,
+        though calling :meth:`using` on it returns a new (uncompiled) subclass as usual.
+        """
+        # NOTE: mixins & subclasses should wrap this, and only replace methods
+        #       they own which haven't been overridden further down the mro.
+        return type(cls.__name__, (cls,), dict(__module__=cls.__module__, _configured=True,
+                                                _compiled=True))
+
     #===================================================================
     # eoc
     #===================================================================
@@ -630,6 +683,31 @@ class GenericHandler(MinimalHandler):
 
         return checksum
 
+    @classmethod
+    def _compile(cls):
+        subcls = super(GenericHandler, cls)._compile()
+
+        # replace _norm_checksum() with version that has size & charset pre-resolved,
+        # (unless subclass overrides it, or the size depends on instance state, as with fshp)
+        size = subcls.checksum_size
+        if _is_inherited_from(subcls, "_norm_checksum", GenericHandler) and \
+                (size is None or isinstance(size, int_types)):
+            raw = subcls._checksum_is_bytes
+            ctype = bytes if raw else unicode
+            chars = None if raw else subcls.checksum_chars
+            charset = frozenset(chars) if chars else None
+            generic = get_unbound_method_function(GenericHandler._norm_checksum)
+
+            def _norm_checksum(self, checksum, relaxed=False):
+                if isinstance(checksum, ctype) and (not size or len(checksum) == size) and \
+                        (charset is None or charset.issuperset(checksum)):
+                    return checksum
+                # let generic implementation handle errors & coercion
+                return generic(self, checksum, relaxed=relaxed)
+
+            subcls._norm_checksum = _norm_checksum
+        return subcls
+
     #===================================================================
     # password hash api - formatting interface
     #===================================================================
@@ -743,7 +821,7 @@ class GenericHandler(MinimalHandler):
                 warn_hash_settings_deprecation(cls, settings)
                 return cls.using(**settings).hash(secret, **kwds)
         # NOTE: at this point, 'kwds' should just contain context_kwds subset
-        validate_secret(secret)
+        secret = validate_secret(secret)
         self = cls(use_defaults=True, **kwds)
         self.checksum = self._calc_checksum(secret)
         return self.to_string()
@@ -753,13 +831,92 @@ class GenericHandler(MinimalHandler):
         # NOTE: classes with multiple checksum encodings should either
         # override this method, or ensure that from_string() / _norm_checksum()
         # ensures .checksum always uses a single canonical representation.
-        validate_secret(secret)
+        secret = validate_secret(secret)
         self = cls.from_string(hash, **context)
         chk = self.checksum
         if chk is None:
             raise exc.MissingDigestError(cls)
         return consteq(self._calc_checksum(secret), chk)
 
+    @classmethod
+    def _verify_phases(cls, secret, hash, phases, **context):
+        """
+        helper for :meth:`CryptContext.trace() <passlib.context.CryptContext.trace>` --
+        same as :meth:`verify`, but stores the seconds spent in each phase in the *phases* dict:
+        ``"parse"`` (:meth:`from_string`, including decoding the checksum),
+        ``"kdf"`` (:meth:`_calc_checksum`, including encoding its result), and ``"compare"``.
+        classes which override :meth:`verify` are timed as a single ``"verify"`` phase.
+        """
+        if not _is_inherited_from(cls, "verify", GenericHandler):
+            start = timer()
+            try:
+                return cls.verify(secret, hash, **context)
+            finally:
+                phases["verify"] = timer() - start
+        secret = validate_secret(secret)
+        start = timer()
+        self = cls.from_string(hash, **context)
+        chk = self.checksum
+        if chk is None:
+            raise exc.MissingDigestError(cls)
+        parsed = timer()
+        phases["parse"] = parsed - start
+        result = self._calc_checksum(secret)
+        calculated = timer()
+        phases["kdf"] = calculated - parsed
+        result = consteq(result, chk)
+        phases["compare"] = timer() - calculated
+        return result
+
+    #: optional attrs for hashes whose checksum is a single digest of the secret & salt.
+    #: if :attr:`!_salted_digest` is set to the digest name, subclass must also provide the following
+    #: classmethods, which :meth:`verify_many` uses to check a whole batch via
+    #: :func:`~passlib.crypto.digest.digest_many`, without building a handler instance per hash:
+    #:
+    #: * ``_parse_salted_digest(hash) -> (salt, raw checksum bytes)`` --
+    #:   should raise the same errors as :meth:`from_string` for hashes it rejects,
+    #:   and must reject any hash whose salt :meth:`from_string` wouldn't accept.
+    #: * ``_salted_digest_message(secret, salt) -> bytes`` -- returns digest input.
+    _salted_digest = None
+
+    @classmethod
+    def verify_many(cls, pairs, **context):
+        """
+        verify a batch of ``(secret, hash)`` pairs, returning a list of booleans.
+
+        this default implementation just calls :meth:`verify` for each pair
+        (or uses :attr:`!_salted_digest` if provided);
+        subclasses may override it with something faster.
+        """
+        if cls._salted_digest and not context:
+            return cls._verify_salted_digest_many(pairs)
+        verify = cls.verify
+        return [verify(secret, hash, **context) for secret, hash in pairs]
+
+    @classmethod
+    def _verify_salted_digest_many(cls, pairs):
+        """helper for verify_many() -- batch path for :attr:`!_salted_digest` hashes"""
+        from passlib.crypto.digest import digest_many
+        parse = cls._parse_salted_digest
+        build = cls._salted_digest_message
+        messages = []
+        entries = []
+        for secret, hash in pairs:
+            secret = validate_secret(secret)
+            salt, chk = parse(hash)
+            messages.append(build(secret, salt))
+            entries.append((hash, chk))
+        result = []
+        append = result.append
+        for (hash, chk), raw in zip(entries, digest_many(cls._salted_digest, messages)):
+            if consteq(raw, chk):
+                append(True)
+            else:
+                # NOTE: only fully validating hash after a mismatch, same as StaticHandler.verify()
+                cls.from_string(hash)
+                append(False)
+        return result
+
     #===================================================================
     # legacy crypt interface
     #===================================================================
@@ -782,7 +939,7 @@ class GenericHandler(MinimalHandler):
     def genhash(cls, secret, config, **context):
         if config is None:
             raise TypeError("config must be string")
-        validate_secret(secret)
+        secret = validate_secret(secret)
         self = cls.from_string(config, **context)
         self.checksum = self._calc_checksum(secret)
         return self.to_string()
@@ -910,10 +1067,26 @@ class StaticHandler(GenericHandler):
     # optional constant prefix subclasses can specify
     _hash_prefix = u""
 
+    #: optional classmethod subclasses can provide, with the signature
+    #: ``_calc_static_checksum(secret, **context) -> checksum``.
+    #: it should return the same value as :meth:`_calc_checksum`,
+    #: but without needing an instance.  when present, :meth:`verify` and
+    #: :meth:`verify_many` use it to avoid constructing a handler object per call
+    #: (unless a subclass overrides :meth:`_calc_checksum`).
+    _calc_static_checksum = None
+
     @classmethod
     def from_string(cls, hash, **context):
         # default from_string() which strips optional prefix,
         # and passes rest unchanged as checksum value.
+        return cls(checksum=cls._parse_checksum(hash), **context)
+
+    @classmethod
+    def _parse_checksum(cls, hash):
+        """
+        helper for from_string() & verify() --
+        normalizes hash & strips prefix, returning the (unvalidated) checksum portion.
+        """
         hash = to_unicode(hash, "ascii", "hash")
         hash = cls._norm_hash(hash)
         # could enable this for extra strictness
@@ -926,7 +1099,7 @@ class StaticHandler(GenericHandler):
                 hash = hash[len(prefix):]
             else:
                 raise exc.InvalidHashError(cls)
-        return cls(checksum=hash, **context)
+        return hash
 
     @classmethod
     def _norm_hash(cls, hash):
@@ -936,6 +1109,70 @@ class StaticHandler(GenericHandler):
     def to_string(self):
         return uascii_to_str(self._hash_prefix + self.checksum)
 
+    def _calc_checksum(self, secret):
+        calc = self._calc_static_checksum
+        if calc is None:
+            return super(StaticHandler, self)._calc_checksum(secret)
+        return calc(secret, **self._get_static_context())
+
+    def _get_static_context(self):
+        """
+        return context keywords stored on instance, for passing to _calc_static_checksum().
+        """
+        return dict((key, getattr(self, key)) for key in self.context_kwds)
+
+    @classmethod
+    def _get_static_checksum(cls):
+        """
+        return _calc_static_checksum() if verify() may use it, else ``None``.
+        it's ignored if a subclass overrides _calc_checksum(), so verify() keeps agreeing
+        with hash(). the result is cached per class.
+        """
+        try:
+            return cls.__dict__["_static_checksum"]
+        except KeyError:
+            pass
+        calc = cls._calc_static_checksum
+        if calc is not None and not _is_inherited_from(cls, "_calc_checksum", StaticHandler):
+            calc = None
+        cls._static_checksum = calc
+        return calc
+
+    @classmethod
+    def verify(cls, secret, hash, **context):
+        calc = cls._get_static_checksum()
+        if calc is None:
+            return super(StaticHandler, cls).verify(secret, hash, **context)
+        # fast path: compare against the stored checksum directly,
+        # instead of building a handler instance via from_string().
+        secret = validate_secret(secret)
+        chk = cls._parse_checksum(hash)
+        if consteq(calc(secret, **context), chk):
+            return True
+        # NOTE: only validating the checksum after a mismatch; so that malformed
+        #       hashes still raise a ValueError, but correct passwords skip the overhead.
+        #       (well-formedness of the stored hash isn't secret, so this doesn't leak anything)
+        cls(checksum=chk, **context)
+        return False
+
+    @classmethod
+    def verify_many(cls, pairs, **context):
+        calc = cls._get_static_checksum()
+        if calc is None:
+            return super(StaticHandler, cls).verify_many(pairs, **context)
+        parse = cls._parse_checksum
+        result = []
+        append = result.append
+        for secret, hash in pairs:
+            secret = validate_secret(secret)
+            chk = parse(hash)
+            if consteq(calc(secret, **context), chk):
+                append(True)
+            else:
+                cls(checksum=chk, **context)
+                append(False)
+        return result
+
 #=============================================================================
 # GenericHandler mixin classes
 #=============================================================================
@@ -1116,6 +1353,29 @@ class HasManyIdents(GenericHandler):
         # failure!
         raise ValueError("invalid ident: %r" % (ident,))
 
+    @classmethod
+    def _compile(cls):
+        subcls = super(HasManyIdents, cls)._compile()
+
+        # replace _norm_ident() with single dict lookup of all known idents & aliases
+        if _is_inherited_from(subcls, "_norm_ident", HasManyIdents):
+            iv = subcls.ident_values
+            table = dict((ident, ident) for ident in iv)
+            for alias, ident in (subcls.ident_aliases or {}).items():
+                if ident in iv:
+                    table.setdefault(alias, ident)
+            generic = get_method_function(HasManyIdents._norm_ident)
+
+            def _norm_ident(cls, ident):
+                try:
+                    return table[ident]
+                except (KeyError, TypeError):
+                    # let generic implementation handle bytes & errors
+                    return generic(cls, ident)
+
+            subcls._norm_ident = classmethod(_norm_ident)
+        return subcls
+
     #===================================================================
     # password hash api
     #===================================================================
@@ -1420,6 +1680,39 @@ class HasSalt(GenericHandler):
         """
         return getrandstr(rng, cls.default_salt_chars, cls.default_salt_size)
 
+    @classmethod
+    def _compile(cls):
+        subcls = super(HasSalt, cls)._compile()
+
+        # replace _norm_salt() with version that has size & charset pre-resolved
+        if _is_inherited_from(subcls, "_norm_salt", HasSalt):
+            raw = subcls._salt_is_bytes
+            stype = bytes if raw else unicode
+            chars = None if raw else subcls.salt_chars
+            charset = frozenset(chars) if chars else None
+            mn = subcls.min_salt_size or 0
+            mx = subcls.max_salt_size
+            generic = get_method_function(HasSalt._norm_salt)
+
+            def _norm_salt(cls, salt, relaxed=False):
+                if isinstance(salt, stype) and mn <= len(salt) and (not mx or len(salt) <= mx) and \
+                        (charset is None or charset.issuperset(salt)):
+                    return salt
+                # let generic implementation handle errors & coercion
+                return generic(cls, salt, relaxed=relaxed)
+
+            subcls._norm_salt = classmethod(_norm_salt)
+
+        # replace _generate_salt() with version that has size & charset pre-resolved
+        # (NOTE: using(salt=...) replaces _generate_salt, so it's left alone by this)
+        size = subcls.default_salt_size
+        if _is_inherited_from(subcls, "_generate_salt", HasRawSalt):
+            subcls._generate_salt = staticmethod(lambda: getrandbytes(rng, size))
+        elif _is_inherited_from(subcls, "_generate_salt", HasSalt):
+            chars = subcls.default_salt_chars
+            subcls._generate_salt = staticmethod(lambda: getrandstr(rng, chars, size))
+        return subcls
+
     @classmethod
     def bitsize(cls, salt_size=None, **kwds):
         """[experimental method] return info about bitsizes of hash"""
@@ -1788,6 +2081,31 @@ class HasRounds(GenericHandler):
 
         return rounds
 
+    @classmethod
+    def _compile(cls):
+        subcls = super(HasRounds, cls)._compile()
+
+        # replace _norm_rounds() with version that has limits pre-resolved
+        if _is_inherited_from(subcls, "_norm_rounds", HasRounds):
+            mn = subcls.min_rounds
+            mx = subcls.max_rounds
+            generic = get_method_function(HasRounds._norm_rounds)
+
+            def _norm_rounds(cls, rounds, relaxed=False, param="rounds"):
+                if isinstance(rounds, int_types) and mn <= rounds and (not mx or rounds <= mx):
+                    return rounds
+                # let generic implementation handle errors & clamping
+                return generic(cls, rounds, relaxed=relaxed, param=param)
+
+            subcls._norm_rounds = classmethod(_norm_rounds)
+
+        # without vary_rounds, _generate_rounds() always returns same value
+        rounds = subcls.default_rounds
+        if _is_inherited_from(subcls, "_generate_rounds", HasRounds) and \
+                rounds is not None and not subcls.vary_rounds:
+            subcls._generate_rounds = staticmethod(lambda: rounds)
+        return subcls
+
     #===================================================================
     # migration interface
     #===================================================================
@@ -1932,6 +2250,8 @@ class BackendMixin(PasswordHash):
 
         :meth:`set_backend` is intended to be called during application startup --
         it affects global state, and switching backends is not guaranteed threadsafe.
+        To use a specific backend without touching the shared class,
+        pass ``backend`` to :meth:`~passlib.ifc.PasswordHash.using` instead.
 
     Private API (Subclass Hooks)
     ----------------------------
@@ -2053,6 +2373,14 @@ class BackendMixin(PasswordHash):
 
             * ``"default"`` -- use the first available backend.
 
+            * ``"fastest"`` -- benchmark all available backends (checking they produce
+              identical output), and load the fastest one.  The ranking is cached
+              per host, see :func:`passlib.utils.rank_fastest`.
+              Classes which don't implement :meth:`_get_backend_benchmark` behave
+              as if ``"default"`` was specified.
+
+              .. versionadded:: 1.8
+
             * any string in :attr:`backends`, loads specified backend.
 
         :param dryrun:
@@ -2083,6 +2411,12 @@ class BackendMixin(PasswordHash):
         if owner is not cls:
             return owner.set_backend(name, dryrun=dryrun)
 
+        # benchmark available backends, and load the fastest
+        if name == "fastest":
+            if not dryrun:
+                return cls._set_fastest_backend()
+            name = "default"
+
         # pick first available backend
         if name == "any" or name == "default":
             default_error = None
@@ -2120,10 +2454,52 @@ class BackendMixin(PasswordHash):
                 cls.__backend = name
             return name
 
+    @classmethod
+    def using(cls, backend=None, **kwds):
+        """
+        wraps :meth:`~passlib.ifc.PasswordHash.using` to accept a ``backend`` keyword,
+        which returns a subclass pinned to the specified backend
+        (any name accepted by :meth:`set_backend`).  Unlike :meth:`set_backend`,
+        this doesn't modify the original class, and later calls to its :meth:`set_backend`
+        don't affect the returned subclass.
+
+        .. versionadded:: 1.8
+        """
+        subcls = super(BackendMixin, cls).using(**kwds)
+        if backend is not None:
+            subcls = subcls._pin_backend(backend)
+        return subcls
+
+    @classmethod
+    def _pin_backend(cls, name):
+        """
+        helper for :meth:`using` --
+        returns subclass which owns its backend, and loads *name* into it.
+        """
+        subcls = type(cls.__name__, cls._get_pinned_bases(name),
+                      dict(__module__=cls.__module__,
+                           _BackendMixin__backend=None, **cls._get_pinned_attrs()))
+        subcls.set_backend(name)
+        return subcls
+
     #===================================================================
     # subclass hooks
     #===================================================================
 
+    @classmethod
+    def _get_pinned_bases(cls, name):
+        """
+        hook for :meth:`_pin_backend` -- returns bases for pinned subclass.
+        """
+        return (cls,)
+
+    @classmethod
+    def _get_pinned_attrs(cls):
+        """
+        hook for :meth:`_pin_backend` -- returns extra attrs for pinned subclass.
+        """
+        return {}
+
     @classmethod
     def _get_backend_owner(cls):
         """
@@ -2171,6 +2547,38 @@ class BackendMixin(PasswordHash):
         """
         raise NotImplementedError("implement in subclass")
 
+    @classmethod
+    def _set_fastest_backend(cls):
+        """
+        helper for ``set_backend("fastest")`` --
+        ranks available backends using :func:`~passlib.utils.rank_fastest`, and loads the winner.
+        """
+        available = [name for name in cls.backends if cls.has_backend(name)]
+        prepare = cls._get_backend_benchmark() if len(available) > 1 else None
+        if prepare is None:
+            return cls.set_backend("default")
+        # NOTE: benchmarking loads each candidate in turn, so if ranking fails,
+        #       restoring original backend rather than leaving whichever was loaded last.
+        orig = cls.__backend
+        chosen = None
+        try:
+            ranking = rank_fastest("backend:%s" % cls.name, available, prepare)
+            chosen = ranking[0] if ranking else "default"
+        finally:
+            if chosen is None and orig:
+                cls.set_backend(orig)
+        return cls.set_backend(chosen)
+
+    @classmethod
+    def _get_backend_benchmark(cls):
+        """
+        Hook used by ``set_backend("fastest")``.
+        Should return a ``prepare(name)`` callable suitable for :func:`~passlib.utils.rank_fastest`,
+        which loads the specified backend, and returns a callable that runs it once
+        against a fixed input.  Returns ``None`` if benchmarking isn't supported.
+        """
+        return None
+
     @classmethod
     def _stub_requires_backend(cls):
         """
@@ -2188,6 +2596,31 @@ class BackendMixin(PasswordHash):
     # eoc
     #===================================================================
 
+def _get_checksum_benchmark(cls):
+    """
+    helper for GenericHandler-based _get_backend_benchmark() implementations --
+    times _calc_checksum() for a fixed salt & secret, using a low rounds value
+    so slow backends don't stall the first hash.
+    """
+    kwds = {}
+    if "rounds" in cls.setting_kwds:
+        if cls.rounds_cost == "log2":
+            kwds['rounds'] = cls.min_rounds
+        else:
+            kwds['rounds'] = max(cls.min_rounds, (cls.default_rounds or 0) // 100)
+    if "user" in cls.context_kwds:
+        kwds['user'] = u"user"
+    self = cls(use_defaults=True, **kwds)
+    secret = u"passlib backend benchmark"
+
+    def prepare(name):
+        cls.set_backend(name)
+        # NOTE: looked up after loading, since backend may replace _calc_checksum()
+        calc = self._calc_checksum
+        return lambda: calc(secret)
+
+    return prepare
+
 class SubclassBackendMixin(BackendMixin):
     """
     variant of BackendMixin which allows backends to be implemented
@@ -2256,11 +2689,38 @@ class SubclassBackendMixin(BackendMixin):
             dryrun=dryrun,
         )
 
+    @classmethod
+    def _get_pinned_bases(cls, name):
+        # pinned subclass gets its own copy of the backend's mixin, placed ahead of <cls>;
+        # so it becomes the owner of its bases, and keeps that mixin even if
+        # cls.set_backend() later swaps out the mixin installed in <cls>.
+        if name in ("any", "default", "fastest"):
+            name = cls.set_backend(name, dryrun=True)
+        mixin_map = cls._backend_mixin_map
+        assert mixin_map, "_backend_mixin_map not specified"
+        if name not in mixin_map:
+            raise exc.UnknownBackendError(cls, name)
+        mixin_cls = mixin_map[name]
+        mixin_copy = type(mixin_cls.__name__, (mixin_cls,),
+                          dict(__module__=mixin_cls.__module__))
+        return (mixin_copy, cls)
+
+    @classmethod
+    def _get_pinned_attrs(cls):
+        return dict(_backend_mixin_target=True)
+
     @classmethod
     def _get_backend_loader(cls, name):
         assert cls._backend_mixin_map, "_backend_mixin_map not specified"
         return cls._backend_mixin_map[name]._load_backend_mixin
 
+    @classmethod
+    def _get_backend_benchmark(cls):
+        # backend mixins provide _calc_checksum(), so can benchmark it once each is loaded in
+        if not issubclass(cls, GenericHandler):
+            return super(SubclassBackendMixin, cls)._get_backend_benchmark()
+        return _get_checksum_benchmark(cls)
+
     #===================================================================
     # eoc
     #===================================================================
@@ -2321,6 +2781,10 @@ class HasManyBackends(BackendMixin, GenericHandler):
         #       and then invoke _calc_checksum_backend() to do the work.
         return self._calc_checksum_backend(secret)
 
+    @classmethod
+    def _get_backend_benchmark(cls):
+        return _get_checksum_benchmark(cls)
+
     def _calc_checksum_backend(self, secret):
         """
         stub for _calc_checksum_backend() --
@@ -0,0 +1,301 @@
+"""cli helper for estimating how many logins/second a host can sustain for a given hash
+
+where ``choose_rounds.py`` times a single verify() call, this drives
+:meth:`CryptContext.verify` from an increasing number of threads & processes,
+and reports the throughput / latency curve for each scheme & backend
+(plus memory use for memory-hard hashes). It then recommends the largest
+rounds value which still meets the requested p99 latency & login rate.
+"""
+#=============================================================================
+# imports
+#=============================================================================
+from __future__ import division, print_function
+# core
+import argparse
+import logging; log = logging.getLogger(__name__)
+import math
+import multiprocessing
+import sys
+import threading
+# site
+# pkg
+from passlib.context import CryptContext
+from passlib.registry import get_crypt_handler
+from passlib.utils import cpu_count, tick
+from choose_rounds import rounds_to_cost, cost_to_rounds, clamp_rounds, estimate_speed
+# local
+__all__ = [
+    "measure",
+    "recommend",
+    "main",
+]
+
+#=============================================================================
+# helpers
+#=============================================================================
+
+#: schemes measured if none are specified on command line
+DEFAULT_SCHEMES = ["bcrypt", "argon2", "scrypt", "pbkdf2_sha256", "sha512_crypt"]
+
+_SECRET = "S0m3-S3Kr1T"
+
+def memory_per_call(hasher):
+    """return bytes of working memory used by a single hash call (or None if negligible)"""
+    name = hasher.name
+    if name == "scrypt":
+        return 128 * hasher.block_size * (2 ** hasher.default_rounds + hasher.parallelism)
+    elif name == "argon2":
+        return 1024 * hasher.memory_cost
+    return None
+
+def percentile(sorted_values, pct):
+    """return percentile of sorted list (nearest-rank method)"""
+    if not sorted_values:
+        return None
+    idx = int(math.ceil(pct / 100.0 * len(sorted_values))) - 1
+    return sorted_values[max(0, idx)]
+
+def _verify_loop(config, hash, duration):
+    """run verify() in a loop for *duration* seconds, returning list of latencies"""
+    context = CryptContext.from_string(config)
+    verify = context.verify
+    latencies = []
+    append = latencies.append
+    end = tick() + duration
+    while True:
+        start = tick()
+        if not verify(_SECRET, hash):
+            raise RuntimeError("verify() failed")
+        now = tick()
+        append(now - start)
+        if now > end:
+            return latencies
+
+def _process_worker(args):
+    """worker for process pool -- returns ``(latencies, peak rss bytes or None)``"""
+    config, hash, name, backend, duration = args
+    if backend:
+        get_crypt_handler(name).set_backend(backend)
+    latencies = _verify_loop(config, hash, duration)
+    try:
+        import resource
+    except ImportError: # pragma: no cover -- platform dependant
+        rss = None
+    else:
+        # NOTE: linux reports kilobytes, BSD / OSX report bytes
+        rss = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+        if sys.platform.startswith("linux"):
+            rss *= 1024
+    return latencies, rss
+
+def _run_threads(config, hash, workers, duration):
+    """run verify loop in *workers* threads, returning per-thread latencies"""
+    results = []
+    def target():
+        results.append(_verify_loop(config, hash, duration))
+    threads = [threading.Thread(target=target) for _ in range(workers)]
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+    if len(results) != workers:
+        raise RuntimeError("verify() thread failed")
+    return results, None
+
+def _run_processes(config, hash, backend, workers, duration):
+    """run verify loop in *workers* processes, returning per-process latencies & peak rss"""
+    pool = multiprocessing.Pool(workers)
+    try:
+        name = CryptContext.from_string(config).default_scheme()
+        results = pool.map(_process_worker, [(config, hash, name, backend, duration)] * workers)
+    finally:
+        pool.terminate()
+        pool.join()
+    rss = [value for _, value in results if value is not None]
+    return [latencies for latencies, _ in results], (max(rss) if rss else None)
+
+def measure(context, backend=None, levels=None, modes=("threads", "processes"), duration=2):
+    """
+    measure throughput & latency of context's default scheme at increasing concurrency.
+
+    :returns:
+        list of dicts, one per ``(mode, workers)`` combination, containing
+        ``"mode"``, ``"workers"``, ``"rate"`` (verify calls / second),
+        ``"p50"`` & ``"p99"`` (latency in seconds), and ``"rss"`` (peak resident memory
+        of a worker process in bytes, or ``None`` when using threads).
+    """
+    if levels is None:
+        levels = concurrency_levels(2 * cpu_count())
+    config = context.to_string()
+    hash = context.hash(_SECRET)
+    rows = []
+    for mode in modes:
+        for workers in levels:
+            if mode == "threads":
+                results, rss = _run_threads(config, hash, workers, duration)
+            else:
+                assert mode == "processes"
+                results, rss = _run_processes(config, hash, backend, workers, duration)
+            # NOTE: summing per-worker rates, so thread / process startup isn't counted
+            rate = sum(len(latencies) / sum(latencies) for latencies in results)
+            latencies = sorted(value for values in results for value in values)
+            rows.append(dict(mode=mode, workers=workers, rate=rate,
+                             p50=percentile(latencies, 50),
+                             p99=percentile(latencies, 99),
+                             rss=rss))
+    return rows
+
+def concurrency_levels(limit):
+    """return powers of 2 up to (and including) *limit*"""
+    levels = []
+    value = 1
+    while value < limit:
+        levels.append(value)
+        value *= 2
+    levels.append(limit)
+    return levels
+
+def recommend(hasher, rounds, rows, p99, min_rate, max_memory=None):
+    """
+    given rows measured using *rounds*, estimate the largest rounds value which
+    keeps p99 latency <= *p99* seconds while sustaining *min_rate* verify calls / second.
+
+    this assumes throughput & latency both scale linearly with cost,
+    and (for memory-hard hashes) that memory use scales with cost if the
+    rounds parameter controls it (as with scrypt).
+
+    :returns:
+        ``(rounds, row)`` tuple, where *row* is the measurement the estimate was based on;
+        or ``(None, None)`` if no configuration meets the constraints.
+    """
+    cost = rounds_to_cost(hasher, rounds)
+    memory = memory_per_call(hasher) if hasher.name == "scrypt" else None
+    best = best_row = None
+    for row in rows:
+        # max cost which keeps this row's rate & p99 within limits
+        scale = min(row["rate"] / min_rate, p99 / row["p99"])
+        if memory and max_memory:
+            scale = min(scale, max_memory / (memory * row["workers"]))
+        if best is None or scale > best:
+            best, best_row = scale, row
+    if best is None:
+        return None, None
+    target = cost_to_rounds(hasher, cost * best)
+    result = clamp_rounds(hasher, math.floor(target))
+    if rounds_to_cost(hasher, result) > cost * best:
+        # can't go below hasher's min_rounds
+        return None, best_row
+    return result, best_row
+
+def calibrate(hasher, target):
+    """pick rounds value where a single verify() takes roughly *target* seconds"""
+    # NOTE: starting well below default_rounds, so slow backends (e.g. builtin scrypt)
+    #       don't take forever to measure.
+    rounds = clamp_rounds(hasher, cost_to_rounds(hasher, rounds_to_cost(hasher, hasher.default_rounds) / 64))
+    speed = estimate_speed(hasher, rounds)
+    for _ in range(2):
+        rounds = clamp_rounds(hasher, cost_to_rounds(hasher, speed * target))
+        speed = estimate_speed(hasher, rounds)
+    return rounds
+
+def _parse_scheme(value):
+    """parse ``scheme[:rounds]`` argument"""
+    name, _, rounds = value.partition(":")
+    try:
+        hasher = get_crypt_handler(name)
+    except KeyError:
+        raise argparse.ArgumentTypeError("unknown hash %r" % name)
+    if rounds:
+        try:
+            rounds = int(rounds)
+        except ValueError:
+            raise argparse.ArgumentTypeError("rounds must be an integer: %r" % value)
+        if "rounds" not in hasher.setting_kwds:
+            raise argparse.ArgumentTypeError("%s does not support variable rounds" % name)
+    return hasher, (rounds or None)
+
+def _format_bytes(value):
+    if value is None:
+        return "-"
+    return "%.1fMB" % (value / (1 << 20))
+
+#=============================================================================
+# main
+#=============================================================================
+def main(*args):
+    parser = argparse.ArgumentParser(
+        prog="plan_capacity.py",
+        description="estimate login capacity of this host for each hash scheme & backend")
+    parser.add_argument("schemes", metavar="scheme[:rounds]", nargs="*", type=_parse_scheme,
+                        help="schemes to measure (default: %s). if rounds aren't specified, "
+                             "they're calibrated so one verify() takes roughly p99/4"
+                             % " ".join(DEFAULT_SCHEMES))
+    parser.add_argument("--p99", type=float, default=350,
+                        help="target p99 latency in milliseconds (default: %(default)s)")
+    parser.add_argument("--rate", type=float, default=50,
+                        help="logins/second the host must sustain (default: %(default)s)")
+    parser.add_argument("--max-memory", type=float, default=None,
+                        help="memory budget in MB for concurrent hash calls (scrypt only)")
+    parser.add_argument("--max-workers", type=int, default=2 * cpu_count(),
+                        help="largest number of threads / processes to try (default: %(default)s)")
+    parser.add_argument("--mode", choices=["threads", "processes", "both"], default="both",
+                        help="concurrency model to measure (default: %(default)s)")
+    parser.add_argument("--duration", type=float, default=2,
+                        help="seconds to run each measurement (default: %(default)s)")
+    opts = parser.parse_args(args)
+
+    schemes = opts.schemes or [(get_crypt_handler(name), None) for name in DEFAULT_SCHEMES]
+    modes = ("threads", "processes") if opts.mode == "both" else (opts.mode,)
+    levels = concurrency_levels(opts.max_workers)
+    p99 = opts.p99 * .001
+    max_memory = opts.max_memory * (1 << 20) if opts.max_memory else None
+
+    for hasher, rounds in schemes:
+        backends = [None]
+        if hasattr(hasher, "backends"):
+            backends = [name for name in hasher.backends if hasher.has_backend(name)]
+            if not backends:
+                print("hash............: %s (skipped, no backends available)\n" % hasher.name)
+                continue
+        for backend in backends:
+            if backend:
+                hasher.set_backend(backend)
+            if "rounds" in hasher.setting_kwds:
+                scheme_rounds = rounds or calibrate(hasher, p99 / 4)
+                context = CryptContext([hasher.name], **{hasher.name + "__rounds": scheme_rounds})
+            else:
+                scheme_rounds = None
+                context = CryptContext([hasher.name])
+            handler = context.handler()
+            print("hash............: %s%s" % (hasher.name,
+                  " (using %s backend)" % backend if backend else ""))
+            if scheme_rounds is not None:
+                print("rounds..........: %d" % scheme_rounds)
+            memory = memory_per_call(handler)
+            if memory:
+                print("memory / call...: %s" % _format_bytes(memory))
+            rows = measure(context, backend=backend, levels=levels, modes=modes,
+                           duration=opts.duration)
+            print("  %-10s %7s %11s %9s %9s %9s" % ("mode", "workers", "logins/s", "p50 ms",
+                                                  "p99 ms", "peak rss"))
+            for row in rows:
+                print("  %-10s %7d %11.1f %9.2f %9.2f %9s" % (
+                      row["mode"], row["workers"], row["rate"], row["p50"] * 1000,
+                      row["p99"] * 1000, _format_bytes(row["rss"])))
+            if scheme_rounds is not None:
+                target, row = recommend(handler, scheme_rounds, rows, p99, opts.rate,
+                                        max_memory=max_memory)
+                if target is None:
+                    print("recommendation..: none -- can't sustain %s logins/s at p99 <= %dms" %
+                          (opts.rate, opts.p99))
+                else:
+                    print("recommendation..: rounds=%d (using %d %s)" %
+                          (target, row["workers"], row["mode"]))
+            print()
+
+if __name__ == "__main__":
+    sys.exit(main(*sys.argv[1:]))
+
+#=============================================================================
+# eof
+#=============================================================================